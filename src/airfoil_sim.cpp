@@ -1,43 +1,55 @@
 #define GLM_ENABLE_EXPERIMENTAL
 
 #include <iostream>
-#include <random>
-#include <vector>
+#include <iomanip>
 #include <tuple>
-#include <memory>
+#include <vector>
+#include <GL/glew.h>
 #include <GLFW/glfw3.h>
-#include <GL/GL.h>
 #include <glm/glm.hpp>
-#include <glm/gtx/norm.hpp>
 
-#include "../constants/constants.hpp"
-#include "utils.cpp"
-#include "boundaries/boundaries.hpp"
-#include "particle/particle.hpp"
+#include "constants/constants.hpp"
+#include "utils/utils.hpp"
 #include "solver/solver.hpp"
 #include "simulators/airfoil/airfoil.hpp"
 
+#include "renderer/renderer.hpp"
+
 GLFWwindow* StartGLFW();
 
 
 int main() {
     GLFWwindow* window = StartGLFW();
-    setUpGL(std::make_tuple(0.0f, 0.0f, 0.0f, 0.0f));
+    setUpGL(std::make_tuple(1.0f, 1.0f, 1.0f, 1.0f));
+
+    AirFoilSimulator simulator;
+    Solver& solver = simulator.getSolver();
+    Renderer renderer(solver);
+    solver.startUpdateThread();
 
-    AirFoilSimulator simulator = AirFoilSimulator();
-    simulator.setStepDt(1.0f / 120.0f);
-    simulator.setSubsteps(8);
+    std::vector<FlowSample> samples;
+    float drag_coefficient = 0.0f;
+    float lift_coefficient = 0.0f;
 
     while (!glfwWindowShouldClose(window)) {
         glClear(GL_COLOR_BUFFER_BIT);
-        
-        simulator.update();
-        simulator.render();
+
+        renderer.render();
+
         glfwSwapBuffers(window);
         glfwPollEvents();
+
+        // exponential average, the per-step forces are noisy
+        simulator.takeSamples(samples);
+        for (const FlowSample& sample : samples) {
+            drag_coefficient += 0.02f * (sample.drag_coefficient - drag_coefficient);
+            lift_coefficient += 0.02f * (sample.lift_coefficient - lift_coefficient);
+        }
+        std::cout << "\rParticles: " << solver.getObjectCount() << std::fixed << std::setprecision(3)
+                  << " | Cd: " << drag_coefficient << " | Cl: " << lift_coefficient << "          " << std::flush;
     }
 
     glfwDestroyWindow(window);
     glfwTerminate();
     return 0;
-}
\ No newline at end of file
+}
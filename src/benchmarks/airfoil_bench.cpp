@@ -0,0 +1,131 @@
+#define GLM_ENABLE_EXPERIMENTAL
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <glm/glm.hpp>
+
+#include "../constants/constants.hpp"
+#include "../solver/solver.hpp"
+#include "../simulators/airfoil/airfoil.hpp"
+
+// Headless wind tunnel: runs the airfoil flow to steady state and reports throughput,
+// the particle budget and the mean drag and lift. The defaults hold about 100k particles.
+// It only links the core (no GLFW/OpenGL), e.g. on Linux from src/:
+//   g++ -std=c++17 -O2 benchmarks/airfoil_bench.cpp simulators/airfoil/airfoil.cpp
+//       solver/solver.cpp particle/particle.cpp particleStore/particleStore.cpp
+//       boundaries/boundaries.cpp threadPool/threadPool.cpp spatialGrid/spatialGrid.cpp
+//       kernels/kernels.cpp profiler/profiler.cpp snapshot/snapshot.cpp
+//       commandQueue/commandQueue.cpp simClock/simClock.cpp checkpoint/checkpoint.cpp
+//       trajectory/trajectory.cpp obstacles/obstacles.cpp emitter/emitter.cpp
+//       mortonOrder/mortonOrder.cpp contactCache/contactCache.cpp sleepTracker/sleepTracker.cpp
+//       forceField/forceField.cpp constants/constants.cpp -pthread
+//
+// Options: --steps N --warmup W --radius R --speed U --naca 2412 --aoa DEG
+//          --flow outflow|periodic --forces out.csv (one row per measured step)
+
+struct TunnelBenchConfig {
+    int steps = 300;
+    int warmup = 300;
+    float radius = 1.33f;
+    float speed = 200.0f;
+    std::string naca = "2412";
+    float aoa = 5.0f;
+    std::string flow = "outflow";
+    std::string forces;
+};
+
+static bool parseArgs(int argc, char** argv, TunnelBenchConfig& config){
+    for (int i = 1; i < argc; ++i){
+        const std::string arg = argv[i];
+        if (i + 1 >= argc){
+            std::cerr << "Missing value for " << arg << std::endl;
+            return false;
+        }
+        const std::string value = argv[++i];
+        if (arg == "--steps") config.steps = std::atoi(value.c_str());
+        else if (arg == "--warmup") config.warmup = std::atoi(value.c_str());
+        else if (arg == "--radius") config.radius = static_cast<float>(std::atof(value.c_str()));
+        else if (arg == "--speed") config.speed = static_cast<float>(std::atof(value.c_str()));
+        else if (arg == "--naca") config.naca = value;
+        else if (arg == "--aoa") config.aoa = static_cast<float>(std::atof(value.c_str()));
+        else if (arg == "--flow") config.flow = value;
+        else if (arg == "--forces") config.forces = value;
+        else {
+            std::cerr << "Unknown option " << arg << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char** argv){
+    TunnelBenchConfig config;
+    if (!parseArgs(argc, argv, config)){
+        return 1;
+    }
+
+    WindTunnelConfig tunnel;
+    tunnel.particle_radius = config.radius;
+    tunnel.air_speed = config.speed;
+    tunnel.naca = config.naca;
+    tunnel.angle_of_attack = config.aoa;
+    tunnel.flow_boundary = config.flow == "periodic" ? FlowBoundary::Periodic : FlowBoundary::Outflow;
+
+    AirFoilSimulator simulator(tunnel);
+    Solver& solver = simulator.getSolver();
+    std::vector<FlowSample> samples;
+
+    for (int i = 0; i < config.warmup; ++i){
+        solver.update();
+    }
+    simulator.takeSamples(samples);
+
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < config.steps; ++i){
+        solver.update();
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    simulator.takeSamples(samples);
+
+    std::ofstream forces;
+    if (!config.forces.empty()){
+        forces.open(config.forces);
+        forces << "step,drag,lift,cd,cl,particles,spawned,recycled,removed\n";
+    }
+    double drag = 0.0, lift = 0.0, cd = 0.0, cl = 0.0, particles = 0.0;
+    size_t spawned = 0, recycled = 0, removed = 0;
+    for (const FlowSample& sample : samples){
+        drag += sample.drag;
+        lift += sample.lift;
+        cd += sample.drag_coefficient;
+        cl += sample.lift_coefficient;
+        particles += sample.particles;
+        spawned += sample.spawned;
+        recycled += sample.recycled;
+        removed += sample.removed;
+        if (forces.is_open()){
+            forces << sample.step << "," << sample.drag << "," << sample.lift << "," << sample.drag_coefficient << ","
+                   << sample.lift_coefficient << "," << sample.particles << "," << sample.spawned << ","
+                   << sample.recycled << "," << sample.removed << "\n";
+        }
+    }
+    const double n = std::max<size_t>(1, samples.size());
+
+    std::cout << "NACA " << config.naca << " at " << config.aoa << " deg | flow: " << config.flow
+              << " | radius: " << config.radius << " | speed: " << config.speed
+              << " | threads: " << solver.getNumThreads() << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "particles: " << solver.getObjectCount() << " (mean " << particles / n << ")"
+              << " | per step: spawned " << spawned / n << ", recycled " << recycled / n << ", removed " << removed / n << std::endl;
+    std::cout << "steps/s: " << config.steps / seconds
+              << " | ns/particle/substep: " << std::setprecision(3)
+              << seconds * 1e9 / (static_cast<double>(config.steps) * solver.getSubsteps() * (particles / n)) << std::endl;
+    std::cout << std::setprecision(4) << "drag: " << drag / n << " | lift: " << lift / n
+              << " | Cd: " << cd / n << " | Cl: " << cl / n << std::endl;
+    return 0;
+}
@@ -0,0 +1,75 @@
+#define GLM_ENABLE_EXPERIMENTAL
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <vector>
+#include <cmath>
+#include <glm/glm.hpp>
+
+#include "../constants/constants.hpp"
+#include "../boundaries/boundaries.hpp"
+#include "../solver/solver.hpp"
+
+// Times Solver::update() with the all-pairs and the grid collision pass for
+// increasing particle counts and reports where the grid starts to win.
+
+static double timeSteps(CollisionMode mode, int num_particles, int steps){
+    const float radius = 2.0f;
+    Solver solver(radius);
+    solver.setCollisionMode(mode);
+    solver.setMaxObjects(num_particles);
+    solver.addBoundary(RectBoundingArea::create(GraphicsConstants::SCREEN_WIDTH, GraphicsConstants::SCREEN_HEIGHT));
+
+    // loose lattice so every mode starts from the same state
+    const float spacing = 2.5f * radius;
+    const int per_row = static_cast<int>((GraphicsConstants::SCREEN_WIDTH - 2 * spacing) / spacing);
+    for (int i = 0; i < num_particles; ++i){
+        const float x = spacing + (i % per_row) * spacing;
+        const float y = spacing + (i / per_row) * spacing;
+        auto obj = solver.addObject(glm::vec2({x, y}));
+        solver.setObjectVelocity(obj, glm::vec2({(i % 7) - 3.0f, (i % 5) - 2.0f}));
+    }
+
+    solver.update(); // warm up caches and the grid
+
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < steps; ++i){
+        solver.update();
+    }
+    const auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count() / steps;
+}
+
+int main(){
+    const int counts[] = {100, 250, 500, 1000, 2000, 5000, 10000, 20000, 50000};
+    const double all_pairs_limit_ms = 2000.0; // stop timing all-pairs once a step gets this slow
+
+    std::cout << std::setw(10) << "particles" << std::setw(16) << "all-pairs ms" << std::setw(12) << "grid ms" << std::setw(10) << "speedup" << std::endl;
+
+    int crossover = -1;
+    bool all_pairs_enabled = true;
+    for (const int n : counts){
+        const int steps = n <= 5000 ? 10 : 3;
+        const double grid_ms = timeSteps(CollisionMode::Grid, n, steps);
+
+        std::cout << std::setw(10) << n;
+        if (all_pairs_enabled){
+            const double all_pairs_ms = timeSteps(CollisionMode::AllPairs, n, steps);
+            all_pairs_enabled = all_pairs_ms < all_pairs_limit_ms;
+            if (crossover < 0 && grid_ms < all_pairs_ms){
+                crossover = n;
+            }
+            std::cout << std::setw(16) << std::fixed << std::setprecision(3) << all_pairs_ms;
+            std::cout << std::setw(12) << grid_ms << std::setw(9) << std::setprecision(1) << all_pairs_ms / grid_ms << "x" << std::endl;
+        }
+        else {
+            std::cout << std::setw(16) << "-" << std::setw(12) << std::fixed << std::setprecision(3) << grid_ms << std::setw(10) << "-" << std::endl;
+        }
+    }
+
+    if (crossover > 0){
+        std::cout << "Grid collisions are faster from " << crossover << " particles" << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,123 @@
+#define GLM_ENABLE_EXPERIMENTAL
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <vector>
+#include <random>
+#include <cstdint>
+#include <cstring>
+#include <cstdlib>
+#include <functional>
+#include <glm/glm.hpp>
+
+#include "../constants/constants.hpp"
+#include "../particle/particle.hpp"
+#include "../particleStore/particleStore.hpp"
+#include "../boundaries/boundaries.hpp"
+#include "../kernels/kernels.hpp"
+
+// Reports particles/ns for every kernel at every SIMD level the CPU supports and
+// checks each level against the scalar kernels.
+
+using Kernel = std::function<void(SimdLevel, ParticleStore&)>;
+
+static ParticleStore makeParticles(size_t count){
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> x_dist(-50.0f, GraphicsConstants::SCREEN_WIDTH + 50.0f);
+    std::uniform_real_distribution<float> y_dist(-50.0f, GraphicsConstants::SCREEN_HEIGHT + 50.0f);
+    std::uniform_real_distribution<float> v_dist(-3.0f, 3.0f);
+    std::uniform_real_distribution<float> r_dist(2.0f, 8.0f);
+
+    ParticleStore objects;
+    objects.reserve(count);
+    for (size_t i = 0; i < count; ++i){
+        Particle particle(glm::vec2({x_dist(rng), y_dist(rng)}), r_dist(rng));
+        particle.position_last = particle.position - glm::vec2({v_dist(rng), v_dist(rng)});
+        particle.acceleration = glm::vec2({v_dist(rng), -9.81f});
+        objects.add(particle);
+    }
+    return objects;
+}
+
+static int64_t orderedBits(float f){
+    int32_t bits;
+    std::memcpy(&bits, &f, sizeof(bits));
+    return bits < 0 ? int64_t(INT32_MIN) - bits : bits;
+}
+
+static int64_t maxUlpDifference(const std::vector<float>& a, const std::vector<float>& b){
+    int64_t worst = 0;
+    for (size_t i = 0; i < a.size(); ++i){
+        worst = std::max(worst, std::abs(orderedBits(a[i]) - orderedBits(b[i])));
+    }
+    return worst;
+}
+
+static int64_t compareStores(const ParticleStore& a, const ParticleStore& b){
+    int64_t worst = 0;
+    worst = std::max(worst, maxUlpDifference(a.x, b.x));
+    worst = std::max(worst, maxUlpDifference(a.y, b.y));
+    worst = std::max(worst, maxUlpDifference(a.last_x, b.last_x));
+    worst = std::max(worst, maxUlpDifference(a.last_y, b.last_y));
+    return worst;
+}
+
+int main(){
+    const size_t num_particles = 1 << 20;
+    const int repeats = 20;
+    const ParticleStore initial = makeParticles(num_particles);
+
+    RectBoundingArea rect(GraphicsConstants::SCREEN_WIDTH - 100.0f, GraphicsConstants::SCREEN_HEIGHT - 100.0f);
+    CircleBoundingArea circle(glm::vec2({GraphicsConstants::SCREEN_WIDTH / 2, GraphicsConstants::SCREEN_HEIGHT / 2}), 350.0f);
+
+    const std::pair<const char*, Kernel> kernels[] = {
+        {"integrate", [](SimdLevel level, ParticleStore& objects) { integrateKernel(level, objects, 1.0f / 480.0f, 0, objects.size()); }},
+        {"rect", [&rect](SimdLevel level, ParticleStore& objects) { constrainRectKernel(level, objects, rect, 0.9f, 0, objects.size()); }},
+        {"circle", [&circle](SimdLevel level, ParticleStore& objects) { constrainCircleKernel(level, objects, circle, 0.9f, 0, objects.size()); }},
+    };
+
+    std::vector<SimdLevel> levels = {SimdLevel::Scalar};
+    const SimdLevel best = detectSimdLevel();
+    if (best == SimdLevel::SSE || best == SimdLevel::AVX2){
+        levels.push_back(SimdLevel::SSE);
+    }
+    if (best == SimdLevel::AVX2){
+        levels.push_back(SimdLevel::AVX2);
+    }
+
+    std::cout << "particles: " << num_particles << ", tolerance: " << KERNEL_TOLERANCE_ULPS << " ulp" << std::endl;
+    std::cout << std::setw(10) << "kernel" << std::setw(8) << "level" << std::setw(16) << "particles/ns" << std::setw(10) << "max ulp" << std::endl;
+
+    bool ok = true;
+    for (const auto& [name, kernel] : kernels){
+        ParticleStore reference = initial;
+        kernel(SimdLevel::Scalar, reference);
+
+        for (const SimdLevel level : levels){
+            ParticleStore objects = initial;
+            kernel(level, objects);
+            const int64_t ulps = compareStores(reference, objects);
+            ok = ok && ulps <= KERNEL_TOLERANCE_ULPS;
+
+            double total_ns = 0.0;
+            for (int r = 0; r < repeats; ++r){
+                objects = initial;
+                const auto start = std::chrono::steady_clock::now();
+                kernel(level, objects);
+                const auto end = std::chrono::steady_clock::now();
+                total_ns += std::chrono::duration<double, std::nano>(end - start).count();
+            }
+
+            std::cout << std::setw(10) << name << std::setw(8) << getSimdLevelName(level)
+                      << std::setw(16) << std::fixed << std::setprecision(3) << (num_particles * repeats) / total_ns
+                      << std::setw(10) << ulps << std::endl;
+        }
+    }
+
+    if (!ok){
+        std::cout << "SIMD kernels differ from the scalar path by more than the tolerance" << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,389 @@
+#define GLM_ENABLE_EXPERIMENTAL
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <cstdlib>
+#include <cmath>
+#include <numeric>
+#include <random>
+#include <glm/glm.hpp>
+
+#include "../constants/constants.hpp"
+#include "../boundaries/boundaries.hpp"
+#include "../forceField/forceField.hpp"
+#include "../solver/solver.hpp"
+#include "../trajectory/trajectory.hpp"
+#include "../profiler/profiler.hpp"
+
+// Headless throughput benchmark: spawns N particles, steps M frames and reports
+// steps/s and ns/particle/substep. Built with -DPARTICLE_PROFILING=1 it also
+// prints the per-phase split, per-thread load, pair tests and grid occupancy.
+// It only links the core (no GLFW/OpenGL), e.g. on Linux from src/:
+//   g++ -std=c++17 -O2 -DPARTICLE_PROFILING=1 benchmarks/particle_bench.cpp solver/solver.cpp
+//       particle/particle.cpp particleStore/particleStore.cpp boundaries/boundaries.cpp
+//       threadPool/threadPool.cpp spatialGrid/spatialGrid.cpp kernels/kernels.cpp
+//       profiler/profiler.cpp snapshot/snapshot.cpp commandQueue/commandQueue.cpp
+//       simClock/simClock.cpp checkpoint/checkpoint.cpp trajectory/trajectory.cpp
+//       obstacles/obstacles.cpp emitter/emitter.cpp mortonOrder/mortonOrder.cpp
+//       contactCache/contactCache.cpp sleepTracker/sleepTracker.cpp forceField/forceField.cpp
+//       constants/constants.cpp -pthread
+//
+// Options: --particles N --frames M --warmup W --radius R --substeps S
+//          --boundary circle|rect|capsule|annulus|polygon --pipeline fused|phased --collision grid|allpairs
+//          --simd scalar|sse|avx2 --trace out.json --trajectory out.traj
+//          --size-ratio K --large-fraction F (a fraction F of the particles are K times larger)
+//          --reorder on|off --shuffle 1 (scrambles the spawn order, like a long-mixed run)
+//          --contact-iterations K (cached contacts relaxed K times per substep, grid only)
+//          --sleep U --sleep-steps K (particles slower than U for K steps may sleep, grid only;
+//          use a long --warmup to measure a settled pile)
+//          --fields N --field-radius R (N radial and vortex fields of radius R orbit the
+//          centre, queued every step like a mouse pull)
+//          --checkpoint out.ckpt (saved after the warmup, then restored into a second solver
+//          that reruns the measured frames and is compared with the first)
+// L1D and last-level cache misses are read from perf events where the kernel allows it.
+
+struct BenchConfig {
+    int particles = 20000;
+    int frames = 200;
+    int warmup = 10;
+    float radius = 2.0f;
+    int substeps = 8;
+    std::string boundary = "circle";
+    std::string pipeline = "fused";
+    std::string collision = "grid";
+    std::string simd = "auto";
+    std::string trace;
+    std::string trajectory;
+    float size_ratio = 1.0f;
+    float large_fraction = 0.01f;
+    std::string reorder = "on";
+    bool shuffle = false;
+    int contact_iterations = 0;
+    float sleep_speed = 0.0f;
+    int sleep_steps = 30;
+    int fields = 0;
+    float field_radius = 60.0f;
+    std::string checkpoint;
+};
+
+static bool parseArgs(int argc, char** argv, BenchConfig& config){
+    for (int i = 1; i < argc; ++i){
+        const std::string arg = argv[i];
+        if (i + 1 >= argc){
+            std::cerr << "Missing value for " << arg << std::endl;
+            return false;
+        }
+        const std::string value = argv[++i];
+        if (arg == "--particles") config.particles = std::atoi(value.c_str());
+        else if (arg == "--frames") config.frames = std::atoi(value.c_str());
+        else if (arg == "--warmup") config.warmup = std::atoi(value.c_str());
+        else if (arg == "--radius") config.radius = static_cast<float>(std::atof(value.c_str()));
+        else if (arg == "--substeps") config.substeps = std::atoi(value.c_str());
+        else if (arg == "--boundary") config.boundary = value;
+        else if (arg == "--pipeline") config.pipeline = value;
+        else if (arg == "--collision") config.collision = value;
+        else if (arg == "--simd") config.simd = value;
+        else if (arg == "--trace") config.trace = value;
+        else if (arg == "--trajectory") config.trajectory = value;
+        else if (arg == "--size-ratio") config.size_ratio = static_cast<float>(std::atof(value.c_str()));
+        else if (arg == "--large-fraction") config.large_fraction = static_cast<float>(std::atof(value.c_str()));
+        else if (arg == "--reorder") config.reorder = value;
+        else if (arg == "--shuffle") config.shuffle = std::atoi(value.c_str()) != 0;
+        else if (arg == "--contact-iterations") config.contact_iterations = std::atoi(value.c_str());
+        else if (arg == "--sleep") config.sleep_speed = static_cast<float>(std::atof(value.c_str()));
+        else if (arg == "--sleep-steps") config.sleep_steps = std::atoi(value.c_str());
+        else if (arg == "--fields") config.fields = std::atoi(value.c_str());
+        else if (arg == "--field-radius") config.field_radius = static_cast<float>(std::atof(value.c_str()));
+        else if (arg == "--checkpoint") config.checkpoint = value;
+        else {
+            std::cerr << "Unknown option " << arg << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// Fills the boundary with a loose lattice, row by row from the bottom. With a size
+// ratio above 1 the large particles are spread over a coarse lattice first and the
+// small ones fill the gaps around them.
+static int spawnLattice(Solver& solver, int count, float radius, float size_ratio, float large_fraction){
+    glm::vec2 min_corner, max_corner;
+    const Boundary& boundary = *solver.getBoundary();
+    getBoundaryBounds(boundary, min_corner, max_corner);
+
+    const float spacing = 2.2f * radius;
+    int spawned = 0;
+    std::vector<glm::vec2> large;
+    const float large_radius = size_ratio * radius;
+    const float large_spacing = 2.2f * large_radius;
+    const int columns = std::max(1, static_cast<int>((max_corner.x - min_corner.x) / large_spacing) - 1);
+    const int rows = std::max(1, static_cast<int>((max_corner.y - min_corner.y) / large_spacing) - 1);
+    std::vector<bool> used(static_cast<size_t>(columns) * rows, false);
+    if (size_ratio > 1.0f){
+        // a stride coprime to the node count visits the coarse lattice in a scattered order
+        const size_t nodes = used.size();
+        size_t stride = 7919;
+        while (nodes % stride == 0){
+            stride += 2;
+        }
+        const int target = static_cast<int>(large_fraction * count);
+        for (size_t k = 0; k < nodes && spawned < target; ++k){
+            const size_t node = (k * stride) % nodes;
+            const glm::vec2 position = min_corner + large_spacing * glm::vec2(node % columns + 1, node / columns + 1);
+            if (getBoundaryClearance(boundary, position) < large_spacing){
+                continue;
+            }
+            used[node] = true;
+            auto obj = solver.addObject(position, large_radius);
+            solver.setObjectVelocity(obj, glm::vec2({(spawned % 7) - 3.0f, (spawned % 5) - 2.0f}));
+            ++spawned;
+        }
+    }
+    // small particles keep clear of the large ones on the nearest coarse nodes
+    auto nearLarge = [&](glm::vec2 p) {
+        const int cx = static_cast<int>(std::lround((p.x - min_corner.x) / large_spacing)) - 1;
+        const int cy = static_cast<int>(std::lround((p.y - min_corner.y) / large_spacing)) - 1;
+        for (int x = std::max(0, cx - 1); x <= std::min(columns - 1, cx + 1); ++x){
+            for (int y = std::max(0, cy - 1); y <= std::min(rows - 1, cy + 1); ++y){
+                const glm::vec2 node = min_corner + large_spacing * glm::vec2(x + 1, y + 1);
+                if (used[static_cast<size_t>(y) * columns + x] && glm::length(p - node) < large_radius + spacing){
+                    return true;
+                }
+            }
+        }
+        return false;
+    };
+
+    for (float y = min_corner.y + spacing; y < max_corner.y - spacing && spawned < count; y += spacing){
+        for (float x = min_corner.x + spacing; x < max_corner.x - spacing && spawned < count; x += spacing){
+            if (getBoundaryClearance(boundary, glm::vec2({x, y})) < spacing || (size_ratio > 1.0f && nearLarge(glm::vec2({x, y})))){
+                continue;
+            }
+            auto obj = solver.addObject(glm::vec2({x, y}));
+            solver.setObjectVelocity(obj, glm::vec2({(spawned % 7) - 3.0f, (spawned % 5) - 2.0f}));
+            ++spawned;
+        }
+    }
+    return spawned;
+}
+
+// Queues config.fields fields spread around a circle at half the screen height,
+// alternating attractors and vortices, which turns a little every step.
+static void queueFields(Solver& solver, const BenchConfig& config, glm::vec2 center, int step){
+    const float orbit = GraphicsConstants::SCREEN_HEIGHT / 4;
+    for (int k = 0; k < config.fields; ++k){
+        const float angle = 6.2831853f * k / config.fields + 0.02f * step;
+        ForceField field;
+        field.type = k % 2 == 0 ? ForceFieldType::Radial : ForceFieldType::Vortex;
+        field.position = center + orbit * glm::vec2(std::cos(angle), std::sin(angle));
+        field.radius = config.field_radius;
+        field.strength = 3.0f * config.field_radius;
+        solver.applyForceField(field);
+    }
+}
+
+static glm::vec2 getCenter(){
+    return glm::vec2({GraphicsConstants::SCREEN_WIDTH / 2, GraphicsConstants::SCREEN_HEIGHT / 2});
+}
+
+// everything but the particles, so a checkpoint can be restored into a second solver
+static void configureSolver(Solver& solver, const BenchConfig& config){
+    solver.setSubsteps(config.substeps);
+    solver.setPipelineMode(config.pipeline == "phased" ? PipelineMode::Phased : PipelineMode::Fused);
+    solver.setCollisionMode(config.collision == "allpairs" ? CollisionMode::AllPairs : CollisionMode::Grid);
+    if (config.simd == "scalar") solver.setSimdLevel(SimdLevel::Scalar);
+    else if (config.simd == "sse") solver.setSimdLevel(SimdLevel::SSE);
+    else if (config.simd == "avx2") solver.setSimdLevel(SimdLevel::AVX2);
+    if (config.reorder == "off") solver.setReorderThreshold(0.0f);
+    solver.setContactIterations(config.contact_iterations);
+
+    const glm::vec2 center = getCenter();
+    const float half_height = GraphicsConstants::SCREEN_HEIGHT / 2;
+    if (config.boundary == "rect"){
+        solver.addBoundary(RectBoundingArea::create(GraphicsConstants::SCREEN_WIDTH, GraphicsConstants::SCREEN_HEIGHT));
+    }
+    else if (config.boundary == "capsule"){
+        const glm::vec2 half_axis({GraphicsConstants::SCREEN_WIDTH / 2 - half_height, 0.0f});
+        solver.addBoundary(CapsuleBoundingArea::create(center - half_axis, center + half_axis, half_height));
+    }
+    else if (config.boundary == "annulus"){
+        solver.addBoundary(AnnulusBoundingArea::create(center.x, center.y, half_height / 4, half_height));
+    }
+    else if (config.boundary == "polygon"){
+        solver.addBoundary(PolygonBoundingArea::createRegular(center, half_height, 6));
+    }
+    else {
+        solver.addBoundary(CircleBoundingArea::create(center.x, center.y, half_height));
+    }
+    solver.setSleepThreshold(config.sleep_speed, config.sleep_steps);
+
+    solver.setMaxObjects(config.particles);
+}
+
+int main(int argc, char** argv){
+    BenchConfig config;
+    if (!parseArgs(argc, argv, config)){
+        return 1;
+    }
+
+    // opened before the solver, so its worker threads inherit the counters
+    CacheCounters cache_counters;
+    std::unique_ptr<Solver> owned_solver = std::make_unique<Solver>(config.radius);
+    Solver& solver = *owned_solver;
+    configureSolver(solver, config);
+    const glm::vec2 center = getCenter();
+
+    const int spawned = spawnLattice(solver, config.particles, config.radius, config.size_ratio, config.large_fraction);
+    if (spawned < config.particles){
+        std::cerr << "Only " << spawned << " particles of radius " << config.radius << " fit in the boundary" << std::endl;
+    }
+    if (config.shuffle){
+        std::vector<uint32_t> order(solver.getObjects().size());
+        std::iota(order.begin(), order.end(), 0);
+        std::shuffle(order.begin(), order.end(), std::mt19937(12345));
+        solver.getObjects().permute(order);
+    }
+
+    for (int i = 0; i < config.warmup; ++i){
+        queueFields(solver, config, center, i);
+        solver.update();
+    }
+    double save_ms = 0.0;
+    bool checkpoint_saved = false;
+    if (!config.checkpoint.empty()){
+        const auto save_start = std::chrono::steady_clock::now();
+        checkpoint_saved = solver.saveCheckpoint(config.checkpoint);
+        save_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - save_start).count();
+    }
+    solver.resetStats();
+    solver.setTraceEnabled(!config.trace.empty());
+    if (!config.trajectory.empty()){
+        solver.attachTrajectory(std::make_unique<TrajectoryWriter>(config.trajectory));
+    }
+
+    cache_counters.reset();
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < config.frames; ++i){
+        queueFields(solver, config, center, config.warmup + i);
+        solver.update();
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::unique_ptr<TrajectoryWriter> trajectory = solver.detachTrajectory();
+    const SolverStats stats = solver.getStats();
+    const size_t num_threads = solver.getNumThreads();
+    const SimdLevel simd_level = solver.getSimdLevel();
+    const bool trace_written = !config.trace.empty() && solver.writeTrace(config.trace);
+    const ContactStats contacts = solver.getContactStats();
+    const size_t sleeping = solver.getSleepingCount();
+    std::vector<float> final_x, final_y;
+    if (checkpoint_saved){
+        final_x = solver.getObjects().x;
+        final_y = solver.getObjects().y;
+    }
+    // the worker threads' cache misses are only counted once they have exited
+    owned_solver.reset();
+    const double substeps_run = static_cast<double>(config.frames) * config.substeps;
+
+    std::cout << "particles: " << spawned << " | frames: " << config.frames << " | substeps: " << config.substeps
+              << " | threads: " << num_threads << " | simd: " << getSimdLevelName(simd_level)
+              << " | pipeline: " << config.pipeline << " | collision: " << config.collision
+              << " | reorder: " << config.reorder << (config.shuffle ? " (shuffled)" : "") << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "steps/s: " << config.frames / seconds << std::endl;
+    std::cout << "ns/particle/substep: " << std::setprecision(3) << seconds * 1e9 / (substeps_run * spawned) << std::endl;
+    if (cache_counters.isAvailable()){
+        const double particle_substeps = substeps_run * spawned;
+        std::cout << "cache misses/particle/substep: L1D " << cache_counters.getL1DataMisses() / particle_substeps
+                  << " | last level " << cache_counters.getLastLevelMisses() / particle_substeps << std::endl;
+    }
+    else {
+        std::cout << "cache misses: unavailable (no perf event access)" << std::endl;
+    }
+    if (config.contact_iterations > 0){
+        std::cout << "contacts: " << contacts.contacts << " | rebuilds/step: " << contacts.rebuilds
+                  << " | residual: " << std::setprecision(4) << contacts.initial_residual
+                  << " -> " << contacts.final_residual << " (last step)" << std::endl;
+    }
+    if (config.sleep_speed > 0.0f){
+        std::cout << "sleeping: " << sleeping << "/" << spawned << " (last step)" << std::endl;
+    }
+    if (trajectory){
+        trajectory->close();
+        const TrajectoryStats written = trajectory->getStats();
+        std::cout << "trajectory: " << written.frames << " frames | bytes/particle/frame: "
+                  << static_cast<double>(written.bytes) / std::max<uint64_t>(1, written.particles)
+                  << " | writer stalls: " << written.stalls << std::endl;
+    }
+    if (checkpoint_saved){
+        // after the cache counters are read, so the second solver does not count
+        Solver restored(config.radius);
+        configureSolver(restored, config);
+        const auto load_start = std::chrono::steady_clock::now();
+        const bool loaded = restored.loadCheckpoint(config.checkpoint);
+        const double load_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - load_start).count();
+        for (int i = 0; loaded && i < config.frames; ++i){
+            queueFields(restored, config, center, config.warmup + i);
+            restored.update();
+        }
+        const ParticleStore& objects = restored.getObjects();
+        bool identical = loaded && final_x.size() == objects.size();
+        for (size_t i = 0; identical && i < objects.size(); ++i){
+            identical = final_x[i] == objects.x[i] && final_y[i] == objects.y[i];
+        }
+        std::cout << "checkpoint: save " << save_ms << " ms | load " << load_ms << " ms | rerun: "
+                  << (!loaded ? "load failed" : identical ? "bit-identical" : "differs") << std::endl;
+    }
+    else if (!config.checkpoint.empty()){
+        std::cerr << "Could not save checkpoint to " << config.checkpoint << std::endl;
+    }
+
+    if (stats.steps == 0){
+        std::cout << "(build with -DPARTICLE_PROFILING=1 for the phase breakdown)" << std::endl;
+        return 0;
+    }
+
+    const double step_ms = stats.get(Phase::Step).total_ms;
+    std::cout << std::setw(12) << "phase" << std::setw(12) << "ms/step" << std::setw(12) << "max ms" << std::setw(10) << "share" << std::endl;
+    for (size_t p = 0; p < PHASE_COUNT; ++p){
+        const PhaseStats& phase = stats.phases[p];
+        if (phase.calls == 0){
+            continue;
+        }
+        std::cout << std::setw(12) << getPhaseName(static_cast<Phase>(p))
+                  << std::setw(12) << std::setprecision(4) << phase.total_ms / stats.steps
+                  << std::setw(12) << phase.max_ms
+                  << std::setw(9) << std::setprecision(1) << 100.0 * phase.total_ms / step_ms << "%" << std::endl;
+    }
+
+    std::cout << std::setw(12) << "thread" << std::setw(12) << "busy ms" << std::setw(12) << "chunks" << std::setw(10) << "load" << std::endl;
+    for (size_t t = 0; t < stats.threads.size(); ++t){
+        const ThreadStats& thread = stats.threads[t];
+        std::cout << std::setw(12) << t << std::setw(12) << std::setprecision(2) << thread.busy_ms
+                  << std::setw(12) << thread.chunks
+                  << std::setw(9) << std::setprecision(1) << 100.0 * thread.busy_ms / step_ms << "%" << std::endl;
+    }
+
+    std::cout << "pair tests/step: " << stats.pair_tests / stats.steps
+              << " | contacts/step: " << stats.contacts / stats.steps << std::endl;
+    std::cout << "grid: " << stats.grid.occupied_cells << "/" << stats.grid.total_cells << " cells occupied"
+              << " | max/cell: " << stats.grid.max_per_cell
+              << " | mean/occupied: " << std::setprecision(2) << stats.grid.mean_per_occupied << std::endl;
+    std::cout << "reorders: " << stats.reorders
+              << " | disorder at last check: " << std::setprecision(3) << stats.disorder << std::endl;
+
+    if (!config.trace.empty()){
+        if (trace_written){
+            std::cout << "trace written to " << config.trace << std::endl;
+        }
+        else {
+            std::cerr << "Could not write trace to " << config.trace << std::endl;
+        }
+    }
+    return 0;
+}
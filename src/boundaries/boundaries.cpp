@@ -1,16 +1,158 @@
 #define GLM_ENABLE_EXPERIMENTAL
 
-#include <memory>
-#include <GLFW/glfw3.h>
-#include <GL/GL.h>
+#include <vector>
+#include <variant>
+#include <cmath>
+#include <algorithm>
 #include <glm/glm.hpp>
 
 #include "../constants/constants.hpp"
+#include "../particleStore/particleStore.hpp"
+#include "../kernels/kernels.hpp"
 
 #include "boundaries.hpp"
 
 
-BoundingArea::~BoundingArea() = default;
+namespace {
+    // Moves particle i to target and reflects the part of its velocity that points
+    // against inward_normal, using the same bounce rule as the circle kernel.
+    inline void pushInside(ParticleStore& objects, size_t i, glm::vec2 target, glm::vec2 inward_normal, float bounce_coefficient) {
+        glm::vec2 velocity = glm::vec2(objects.x[i] - objects.last_x[i], objects.y[i] - objects.last_y[i]);
+        const float velocity_normal = glm::dot(velocity, inward_normal);
+        if (velocity_normal < 0) {
+            velocity -= (1.0f + bounce_coefficient) * velocity_normal * inward_normal;
+        }
+        objects.x[i] = target.x;
+        objects.y[i] = target.y;
+        objects.last_x[i] = target.x - velocity.x;
+        objects.last_y[i] = target.y - velocity.y;
+    }
+
+    inline glm::vec2 closestPointOnSegment(glm::vec2 p, glm::vec2 a, glm::vec2 b) {
+        const glm::vec2 ab = b - a;
+        const float length_sq = glm::dot(ab, ab);
+        if (length_sq <= 0.0f) {
+            return a;
+        }
+        const float t = std::clamp(glm::dot(p - a, ab) / length_sq, 0.0f, 1.0f);
+        return a + ab * t;
+    }
+
+    // unit vector from center towards p, falling back to +x when they coincide
+    inline glm::vec2 directionFrom(glm::vec2 center, glm::vec2 p, float& dist) {
+        const glm::vec2 d = p - center;
+        dist = glm::length(d);
+        return dist > 0.0f ? d / dist : glm::vec2(1.0f, 0.0f);
+    }
+
+    // chord of a circle at height y, as one span
+    inline bool circleChord(glm::vec2 center, float radius, float y, glm::vec2& span) {
+        const float dy = y - center.y;
+        const float h_sq = radius * radius - dy * dy;
+        if (h_sq < 0.0f) {
+            return false;
+        }
+        const float h = std::sqrt(h_sq);
+        span = glm::vec2(center.x - h, center.x + h);
+        return true;
+    }
+
+    // even-odd crossings of a closed polygon with the line y, paired into spans
+    void polygonSpans(const std::vector<glm::vec2>& vertices, float y, std::vector<glm::vec2>& spans) {
+        const size_t n = vertices.size();
+        if (n < 3) {
+            return;
+        }
+        float crossings[64];
+        std::vector<float> crossings_heap;
+        size_t count = 0;
+        for (size_t i = 0, j = n - 1; i < n; j = i++) {
+            const glm::vec2 a = vertices[j];
+            const glm::vec2 b = vertices[i];
+            // half-open rule so a vertex on the line is counted once
+            if ((a.y <= y) != (b.y <= y)) {
+                const float x = a.x + (y - a.y) / (b.y - a.y) * (b.x - a.x);
+                if (count < 64) {
+                    crossings[count] = x;
+                }
+                else {
+                    if (crossings_heap.empty()) {
+                        crossings_heap.assign(crossings, crossings + 64);
+                    }
+                    crossings_heap.push_back(x);
+                }
+                ++count;
+            }
+        }
+        float* xs = count <= 64 ? crossings : crossings_heap.data();
+        std::sort(xs, xs + count);
+        for (size_t k = 0; k + 1 < count; k += 2) {
+            spans.push_back(glm::vec2(xs[k], xs[k + 1]));
+        }
+    }
+
+    bool polygonContains(const std::vector<glm::vec2>& vertices, glm::vec2 p) {
+        bool inside = false;
+        const size_t n = vertices.size();
+        for (size_t i = 0, j = n - 1; i < n; j = i++) {
+            const glm::vec2 a = vertices[j];
+            const glm::vec2 b = vertices[i];
+            if ((a.y <= p.y) != (b.y <= p.y)) {
+                const float x = a.x + (p.y - a.y) / (b.y - a.y) * (b.x - a.x);
+                if (p.x < x) {
+                    inside = !inside;
+                }
+            }
+        }
+        return inside;
+    }
+
+    // distance to the nearest edge and the closest point on it
+    float polygonNearestEdge(const std::vector<glm::vec2>& vertices, glm::vec2 p, glm::vec2& closest) {
+        float best_sq = INFINITY;
+        const size_t n = vertices.size();
+        for (size_t i = 0, j = n - 1; i < n; j = i++) {
+            const glm::vec2 c = closestPointOnSegment(p, vertices[j], vertices[i]);
+            const glm::vec2 d = p - c;
+            const float dist_sq = glm::dot(d, d);
+            if (dist_sq < best_sq) {
+                best_sq = dist_sq;
+                closest = c;
+            }
+        }
+        return std::sqrt(best_sq);
+    }
+
+    bool checkParamCount(const std::vector<float>& params, size_t count) {
+        if (params.size() != count) {
+            return false;
+        }
+        for (float p : params) {
+            if (!std::isfinite(p)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    template <size_t I = 0>
+    bool makeAlternative(size_t index, const std::vector<float>& params, Boundary& boundary) {
+        if constexpr (I < std::variant_size_v<Boundary>) {
+            if (index == I) {
+                std::variant_alternative_t<I, Boundary> shape;
+                if (!shape.setParams(params)) {
+                    return false;
+                }
+                boundary = std::move(shape);
+                return true;
+            }
+            return makeAlternative<I + 1>(index, params, boundary);
+        }
+        else {
+            return false;
+        }
+    }
+}
 
 
 RectBoundingArea::RectBoundingArea(float width, float height){
@@ -22,58 +164,346 @@ RectBoundingArea::RectBoundingArea(float width, float height){
 
     left_side = offset_width;
     right_side = GraphicsConstants::SCREEN_WIDTH - offset_width;
+}
 
-    top_left_vertex = glm::vec2({offset_width, offset_height});
-    top_right_vertex = glm::vec2({GraphicsConstants::SCREEN_WIDTH - offset_width, offset_height});
+RectBoundingArea RectBoundingArea::create(const float width, const float height){
+    return RectBoundingArea(width, height);
+}
 
-    bottom_left_vertex = glm::vec2({offset_width, GraphicsConstants::SCREEN_HEIGHT - offset_height});
-    bottom_right_vertex = glm::vec2({GraphicsConstants::SCREEN_WIDTH - offset_width, GraphicsConstants::SCREEN_HEIGHT - offset_height});
+void RectBoundingArea::getBounds(glm::vec2& min_corner, glm::vec2& max_corner) const {
+    min_corner = glm::vec2({left_side, top_line});
+    max_corner = glm::vec2({right_side, bottom_line});
 }
 
-int RectBoundingArea::getType(){
-    return 1;
+void RectBoundingArea::constrain(SimdLevel level, ParticleStore& objects, float bounce_coefficient, size_t start, size_t end) const {
+    constrainRectKernel(level, objects, *this, bounce_coefficient, start, end);
 }
 
-void RectBoundingArea::draw(){
-    glColor3f(0.0f, 0.0f, 0.0f);
-    glBegin(GL_TRIANGLES);
-    glVertex2f(top_left_vertex.x, top_left_vertex.y);
-    glVertex2f(top_right_vertex.x, top_right_vertex.y);
-    glVertex2f(bottom_left_vertex.x, bottom_left_vertex.y);
-    glVertex2f(bottom_left_vertex.x, bottom_left_vertex.y);
-    glVertex2f(bottom_right_vertex.x, bottom_right_vertex.y);
-    glVertex2f(top_right_vertex.x, top_right_vertex.y);
-    glEnd();
+float RectBoundingArea::getClearance(glm::vec2 p) const {
+    return std::min(std::min(p.x - left_side, right_side - p.x), std::min(p.y - top_line, bottom_line - p.y));
 }
 
-std::unique_ptr<RectBoundingArea> RectBoundingArea::create(const float width, const float height){
-    return std::make_unique<RectBoundingArea>(width, height);
-}    
-    
+void RectBoundingArea::getSpans(float y, std::vector<glm::vec2>& spans) const {
+    if (y >= top_line && y <= bottom_line) {
+        spans.push_back(glm::vec2(left_side, right_side));
+    }
+}
+
+void RectBoundingArea::getParams(std::vector<float>& params) const {
+    params = {top_line, bottom_line, left_side, right_side};
+}
+
+bool RectBoundingArea::setParams(const std::vector<float>& params) {
+    if (!checkParamCount(params, 4) || params[0] > params[1] || params[2] > params[3]) {
+        return false;
+    }
+    top_line = params[0];
+    bottom_line = params[1];
+    left_side = params[2];
+    right_side = params[3];
+    return true;
+}
 
         
 CircleBoundingArea::CircleBoundingArea(glm::vec2 center_, float radius_) 
 : center(center_), radius(radius_) {}
 
-int CircleBoundingArea::getType(){
-    return 2;
+CircleBoundingArea CircleBoundingArea::create(const float center_x, const float center_y, const float radius){
+    return CircleBoundingArea(glm::vec2({center_x, center_y}), radius);
 }
 
-void CircleBoundingArea::draw(const int num_segments){
-    glColor3f(0.0f, 0.0f, 0.0f);
-    glBegin(GL_TRIANGLE_FAN);
-    glVertex2f(center.x, center.y);
-    
-    for (int i = 0; i <= num_segments; ++i) {
-        float angle = 2.0f * 3.14159265359f * (float(i) / num_segments);
-        float x = center.x + cos(angle) * radius;
-        float y = center.y + sin(angle) * radius;
-        glVertex2f(x, y);
+void CircleBoundingArea::getBounds(glm::vec2& min_corner, glm::vec2& max_corner) const {
+    min_corner = center - glm::vec2({radius, radius});
+    max_corner = center + glm::vec2({radius, radius});
+}
+
+void CircleBoundingArea::constrain(SimdLevel level, ParticleStore& objects, float bounce_coefficient, size_t start, size_t end) const {
+    constrainCircleKernel(level, objects, *this, bounce_coefficient, start, end);
+}
+
+float CircleBoundingArea::getClearance(glm::vec2 p) const {
+    return radius - glm::length(p - center);
+}
+
+void CircleBoundingArea::getSpans(float y, std::vector<glm::vec2>& spans) const {
+    glm::vec2 span;
+    if (circleChord(center, radius, y, span)) {
+        spans.push_back(span);
+    }
+}
+
+void CircleBoundingArea::getParams(std::vector<float>& params) const {
+    params = {center.x, center.y, radius};
+}
+
+bool CircleBoundingArea::setParams(const std::vector<float>& params) {
+    if (!checkParamCount(params, 3) || params[2] <= 0.0f) {
+        return false;
+    }
+    center = glm::vec2(params[0], params[1]);
+    radius = params[2];
+    return true;
+}
+
+
+CapsuleBoundingArea::CapsuleBoundingArea(glm::vec2 start_point_, glm::vec2 end_point_, float radius_)
+: start_point(start_point_), end_point(end_point_), radius(radius_) {}
+
+CapsuleBoundingArea CapsuleBoundingArea::create(glm::vec2 start_point, glm::vec2 end_point, const float radius){
+    return CapsuleBoundingArea(start_point, end_point, radius);
+}
+
+void CapsuleBoundingArea::getBounds(glm::vec2& min_corner, glm::vec2& max_corner) const {
+    min_corner = glm::min(start_point, end_point) - glm::vec2(radius);
+    max_corner = glm::max(start_point, end_point) + glm::vec2(radius);
+}
+
+void CapsuleBoundingArea::constrain(SimdLevel, ParticleStore& objects, float bounce_coefficient, size_t start, size_t end) const {
+    const float* radii = objects.radius.data();
+    for (size_t i = start; i < end; ++i) {
+        const glm::vec2 p = glm::vec2(objects.x[i], objects.y[i]);
+        const glm::vec2 spine = closestPointOnSegment(p, start_point, end_point);
+        const float limit = radius - radii[i];
+        const glm::vec2 d = p - spine;
+        if (glm::dot(d, d) > limit * limit) {
+            float dist;
+            const glm::vec2 n = directionFrom(spine, p, dist);
+            pushInside(objects, i, spine + n * limit, -n, bounce_coefficient);
+        }
     }
+}
 
-    glEnd();
+float CapsuleBoundingArea::getClearance(glm::vec2 p) const {
+    return radius - glm::length(p - closestPointOnSegment(p, start_point, end_point));
+}
+
+void CapsuleBoundingArea::getSpans(float y, std::vector<glm::vec2>& spans) const {
+    // the capsule is convex, so its section is one span: the union of the two end
+    // caps and the swept rectangle between them
+    float lo = INFINITY;
+    float hi = -INFINITY;
+    glm::vec2 span;
+    if (circleChord(start_point, radius, y, span)) {
+        lo = std::min(lo, span.x);
+        hi = std::max(hi, span.y);
+    }
+    if (circleChord(end_point, radius, y, span)) {
+        lo = std::min(lo, span.x);
+        hi = std::max(hi, span.y);
+    }
+    const glm::vec2 axis = end_point - start_point;
+    const float length = glm::length(axis);
+    if (length > 0.0f) {
+        const glm::vec2 offset = glm::vec2(-axis.y, axis.x) / length * radius;
+        const std::vector<glm::vec2> body = {start_point + offset, end_point + offset, end_point - offset, start_point - offset};
+        std::vector<glm::vec2> body_spans;
+        polygonSpans(body, y, body_spans);
+        for (const glm::vec2& s : body_spans) {
+            lo = std::min(lo, s.x);
+            hi = std::max(hi, s.y);
+        }
+    }
+    if (lo <= hi) {
+        spans.push_back(glm::vec2(lo, hi));
+    }
+}
+
+void CapsuleBoundingArea::getParams(std::vector<float>& params) const {
+    params = {start_point.x, start_point.y, end_point.x, end_point.y, radius};
+}
+
+bool CapsuleBoundingArea::setParams(const std::vector<float>& params) {
+    if (!checkParamCount(params, 5) || params[4] <= 0.0f) {
+        return false;
+    }
+    start_point = glm::vec2(params[0], params[1]);
+    end_point = glm::vec2(params[2], params[3]);
+    radius = params[4];
+    return true;
 }
 
-std::unique_ptr<CircleBoundingArea> CircleBoundingArea::create(const float center_x, const float center_y, const float radius){
-    return std::make_unique<CircleBoundingArea>(glm::vec2({center_x, center_y}), radius);
-}
\ No newline at end of file
+
+PolygonBoundingArea::PolygonBoundingArea(std::vector<glm::vec2> vertices_)
+: vertices(std::move(vertices_)) {}
+
+PolygonBoundingArea PolygonBoundingArea::create(std::vector<glm::vec2> vertices){
+    return PolygonBoundingArea(std::move(vertices));
+}
+
+PolygonBoundingArea PolygonBoundingArea::createRegular(glm::vec2 center, float radius, int sides){
+    std::vector<glm::vec2> vertices;
+    for (int i = 0; i < sides; ++i) {
+        const float angle = 2.0f * 3.14159265359f * (float(i) / sides);
+        vertices.push_back(center + radius * glm::vec2(std::cos(angle), std::sin(angle)));
+    }
+    return PolygonBoundingArea(std::move(vertices));
+}
+
+void PolygonBoundingArea::getBounds(glm::vec2& min_corner, glm::vec2& max_corner) const {
+    // finite even without vertices, since the grids size themselves from these
+    if (vertices.empty()) {
+        min_corner = glm::vec2(0.0f);
+        max_corner = glm::vec2(0.0f);
+        return;
+    }
+    min_corner = glm::vec2(INFINITY);
+    max_corner = glm::vec2(-INFINITY);
+    for (const glm::vec2& v : vertices) {
+        min_corner = glm::min(min_corner, v);
+        max_corner = glm::max(max_corner, v);
+    }
+}
+
+void PolygonBoundingArea::constrain(SimdLevel, ParticleStore& objects, float bounce_coefficient, size_t start, size_t end) const {
+    if (vertices.size() < 3) {
+        return;
+    }
+    const float* radii = objects.radius.data();
+    for (size_t i = start; i < end; ++i) {
+        const glm::vec2 p = glm::vec2(objects.x[i], objects.y[i]);
+        const float r = radii[i];
+        glm::vec2 closest;
+        const float dist = polygonNearestEdge(vertices, p, closest);
+        const bool inside = polygonContains(vertices, p);
+        if (inside && dist >= r) {
+            continue;
+        }
+        // inward normal points from the wall towards the particle when inside,
+        // and away from it when the particle has left the polygon
+        glm::vec2 n = dist > 0.0f ? (p - closest) / dist : glm::vec2(0.0f);
+        if (!inside) {
+            n = -n;
+        }
+        if (dist <= 0.0f) {
+            // exactly on the edge: step towards the polygon's vertex average
+            glm::vec2 centroid = glm::vec2(0.0f);
+            for (const glm::vec2& v : vertices) {
+                centroid += v;
+            }
+            float unused;
+            n = directionFrom(closest, centroid / static_cast<float>(vertices.size()), unused);
+        }
+        pushInside(objects, i, closest + n * r, n, bounce_coefficient);
+    }
+}
+
+float PolygonBoundingArea::getClearance(glm::vec2 p) const {
+    if (vertices.size() < 3) {
+        return -INFINITY;
+    }
+    glm::vec2 closest;
+    const float dist = polygonNearestEdge(vertices, p, closest);
+    return polygonContains(vertices, p) ? dist : -dist;
+}
+
+void PolygonBoundingArea::getSpans(float y, std::vector<glm::vec2>& spans) const {
+    polygonSpans(vertices, y, spans);
+}
+
+void PolygonBoundingArea::getParams(std::vector<float>& params) const {
+    params.clear();
+    for (const glm::vec2& v : vertices) {
+        params.push_back(v.x);
+        params.push_back(v.y);
+    }
+}
+
+bool PolygonBoundingArea::setParams(const std::vector<float>& params) {
+    if (params.size() < 6 || params.size() % 2 != 0 || !checkParamCount(params, params.size())) {
+        return false;
+    }
+    vertices.clear();
+    for (size_t i = 0; i < params.size(); i += 2) {
+        vertices.push_back(glm::vec2(params[i], params[i + 1]));
+    }
+    return true;
+}
+
+
+AnnulusBoundingArea::AnnulusBoundingArea(glm::vec2 center_, float inner_radius_, float outer_radius_)
+: center(center_), inner_radius(inner_radius_), outer_radius(outer_radius_) {}
+
+AnnulusBoundingArea AnnulusBoundingArea::create(const float center_x, const float center_y, const float inner_radius, const float outer_radius){
+    return AnnulusBoundingArea(glm::vec2({center_x, center_y}), inner_radius, outer_radius);
+}
+
+void AnnulusBoundingArea::getBounds(glm::vec2& min_corner, glm::vec2& max_corner) const {
+    min_corner = center - glm::vec2({outer_radius, outer_radius});
+    max_corner = center + glm::vec2({outer_radius, outer_radius});
+}
+
+void AnnulusBoundingArea::constrain(SimdLevel, ParticleStore& objects, float bounce_coefficient, size_t start, size_t end) const {
+    const float* radii = objects.radius.data();
+    for (size_t i = start; i < end; ++i) {
+        const float r = radii[i];
+        const glm::vec2 p = glm::vec2(objects.x[i], objects.y[i]);
+        float dist;
+        const glm::vec2 n = directionFrom(center, p, dist);
+        if (dist > outer_radius - r) {
+            pushInside(objects, i, center + n * (outer_radius - r), -n, bounce_coefficient);
+        }
+        else if (dist < inner_radius + r) {
+            pushInside(objects, i, center + n * (inner_radius + r), n, bounce_coefficient);
+        }
+    }
+}
+
+float AnnulusBoundingArea::getClearance(glm::vec2 p) const {
+    const float dist = glm::length(p - center);
+    return std::min(outer_radius - dist, dist - inner_radius);
+}
+
+void AnnulusBoundingArea::getSpans(float y, std::vector<glm::vec2>& spans) const {
+    glm::vec2 outer, inner;
+    if (!circleChord(center, outer_radius, y, outer)) {
+        return;
+    }
+    if (!circleChord(center, inner_radius, y, inner)) {
+        spans.push_back(outer);
+        return;
+    }
+    spans.push_back(glm::vec2(outer.x, inner.x));
+    spans.push_back(glm::vec2(inner.y, outer.y));
+}
+
+void AnnulusBoundingArea::getParams(std::vector<float>& params) const {
+    params = {center.x, center.y, inner_radius, outer_radius};
+}
+
+bool AnnulusBoundingArea::setParams(const std::vector<float>& params) {
+    if (!checkParamCount(params, 4) || params[2] < 0.0f || params[3] <= params[2]) {
+        return false;
+    }
+    center = glm::vec2(params[0], params[1]);
+    inner_radius = params[2];
+    outer_radius = params[3];
+    return true;
+}
+
+
+void getBoundaryBounds(const Boundary& boundary, glm::vec2& min_corner, glm::vec2& max_corner) {
+    std::visit([&](const auto& shape) { shape.getBounds(min_corner, max_corner); }, boundary);
+}
+
+float getBoundaryClearance(const Boundary& boundary, glm::vec2 p) {
+    return std::visit([&](const auto& shape) { return shape.getClearance(p); }, boundary);
+}
+
+void getBoundarySpans(const Boundary& boundary, float y, std::vector<glm::vec2>& spans) {
+    std::visit([&](const auto& shape) { shape.getSpans(y, spans); }, boundary);
+}
+
+uint32_t getBoundaryTypeId(const Boundary& boundary) {
+    return static_cast<uint32_t>(boundary.index()) + 1;
+}
+
+void getBoundaryParams(const Boundary& boundary, std::vector<float>& params) {
+    std::visit([&](const auto& shape) { shape.getParams(params); }, boundary);
+}
+
+bool makeBoundary(uint32_t type_id, const std::vector<float>& params, Boundary& boundary) {
+    if (type_id == 0) {
+        return false;
+    }
+    return makeAlternative(type_id - 1, params, boundary);
+}
@@ -2,45 +2,132 @@
 #ifndef BOUNDARIES_HPP
 #define BOUNDARIES_HPP
 
-#include <memory>
+#include <vector>
+#include <variant>
+#include <cstdint>
+#include <cstddef>
 #include <glm/glm.hpp>
 
+class ParticleStore;
+enum class SimdLevel;
 
-struct BoundingArea {
-    virtual ~BoundingArea();
-    virtual int getType() = 0; // Make this a pure virtual function
+// Boundary shapes are plain value types held in the Boundary variant. Callers pick
+// the shape once with std::visit and then call its batch kernel, so the per-particle
+// loops contain no virtual calls or type checks. Every shape provides:
+//   getBounds(min, max)         axis-aligned box around the inside
+//   constrain(level, objects, bounce, start, end)
+//                               keeps particles [start, end) inside, reflecting their velocity
+//   getClearance(p)             distance from p to the nearest wall, negative outside
+//   getSpans(y, spans)          appends the x intervals of the inside along the line y
+//   getParams(params) / setParams(params)
+//                               flat float encoding, used by checkpoints
+// A new shape only needs such a struct and an entry at the end of Boundary.
+
+struct RectBoundingArea {
+    float top_line = 0.0f;
+    float bottom_line = 0.0f;
+    float left_side = 0.0f;
+    float right_side = 0.0f;
+
+    RectBoundingArea() = default;
+    RectBoundingArea(float width, float height); // centred on the screen
+    static RectBoundingArea create(const float width, const float height);
+
+    void getBounds(glm::vec2& min_corner, glm::vec2& max_corner) const;
+    void constrain(SimdLevel level, ParticleStore& objects, float bounce_coefficient, size_t start, size_t end) const;
+    float getClearance(glm::vec2 p) const;
+    void getSpans(float y, std::vector<glm::vec2>& spans) const;
+    void getParams(std::vector<float>& params) const;
+    bool setParams(const std::vector<float>& params);
+};
+
+struct CircleBoundingArea {
+    glm::vec2 center = glm::vec2(0.0f);
+    float radius = 0.0f;
+
+    CircleBoundingArea() = default;
+    CircleBoundingArea(glm::vec2 center_, float radius_);
+    static CircleBoundingArea create(const float center_x, const float center_y, const float radius);
+
+    void getBounds(glm::vec2& min_corner, glm::vec2& max_corner) const;
+    void constrain(SimdLevel level, ParticleStore& objects, float bounce_coefficient, size_t start, size_t end) const;
+    float getClearance(glm::vec2 p) const;
+    void getSpans(float y, std::vector<glm::vec2>& spans) const;
+    void getParams(std::vector<float>& params) const;
+    bool setParams(const std::vector<float>& params);
+};
+
+// Points within radius of the segment [start_point, end_point] (a stadium)
+struct CapsuleBoundingArea {
+    glm::vec2 start_point = glm::vec2(0.0f);
+    glm::vec2 end_point = glm::vec2(0.0f);
+    float radius = 0.0f;
+
+    CapsuleBoundingArea() = default;
+    CapsuleBoundingArea(glm::vec2 start_point_, glm::vec2 end_point_, float radius_);
+    static CapsuleBoundingArea create(glm::vec2 start_point, glm::vec2 end_point, const float radius);
+
+    void getBounds(glm::vec2& min_corner, glm::vec2& max_corner) const;
+    void constrain(SimdLevel level, ParticleStore& objects, float bounce_coefficient, size_t start, size_t end) const;
+    float getClearance(glm::vec2 p) const;
+    void getSpans(float y, std::vector<glm::vec2>& spans) const;
+    void getParams(std::vector<float>& params) const;
+    bool setParams(const std::vector<float>& params);
+};
+
+// Simple (non self-intersecting) polygon in either winding, convex or not. The
+// kernel tests every edge per particle, so keep the vertex count small. With fewer
+// than 3 vertices it constrains nothing, and bounds an empty one at the origin.
+struct PolygonBoundingArea {
+    std::vector<glm::vec2> vertices;
+
+    PolygonBoundingArea() = default;
+    PolygonBoundingArea(std::vector<glm::vec2> vertices_);
+    static PolygonBoundingArea create(std::vector<glm::vec2> vertices);
+    static PolygonBoundingArea createRegular(glm::vec2 center, float radius, int sides);
+
+    void getBounds(glm::vec2& min_corner, glm::vec2& max_corner) const;
+    void constrain(SimdLevel level, ParticleStore& objects, float bounce_coefficient, size_t start, size_t end) const;
+    float getClearance(glm::vec2 p) const;
+    void getSpans(float y, std::vector<glm::vec2>& spans) const;
+    void getParams(std::vector<float>& params) const;
+    bool setParams(const std::vector<float>& params);
 };
 
-struct RectBoundingArea : BoundingArea{
-    public:
-        float top_line;
-        float bottom_line;
-        float left_side;
-        float right_side;
-        
-        RectBoundingArea(float width, float height);
-
-        int getType();
-        void draw();
-        static std::unique_ptr<RectBoundingArea> create(const float width, const float height); 
-
-        private:
-            glm::vec2 top_left_vertex;
-            glm::vec2 top_right_vertex;
-            glm::vec2 bottom_left_vertex;
-            glm::vec2 bottom_right_vertex;
-};      
-
-struct CircleBoundingArea : BoundingArea{
-    public:
-        glm::vec2 center;
-        float radius;
-        
-        CircleBoundingArea(glm::vec2 center_, float radius_);
-
-        int getType();
-        void draw(const int num_segments);
-        static std::unique_ptr<CircleBoundingArea> create(const float center_x, const float center_y, const float radius);
+// Ring between two concentric circles
+struct AnnulusBoundingArea {
+    glm::vec2 center = glm::vec2(0.0f);
+    float inner_radius = 0.0f;
+    float outer_radius = 0.0f;
+
+    AnnulusBoundingArea() = default;
+    AnnulusBoundingArea(glm::vec2 center_, float inner_radius_, float outer_radius_);
+    static AnnulusBoundingArea create(const float center_x, const float center_y, const float inner_radius, const float outer_radius);
+
+    void getBounds(glm::vec2& min_corner, glm::vec2& max_corner) const;
+    void constrain(SimdLevel level, ParticleStore& objects, float bounce_coefficient, size_t start, size_t end) const;
+    float getClearance(glm::vec2 p) const;
+    void getSpans(float y, std::vector<glm::vec2>& spans) const;
+    void getParams(std::vector<float>& params) const;
+    bool setParams(const std::vector<float>& params);
 };
 
-#endif
\ No newline at end of file
+// Alternatives are only ever appended: checkpoints store the index
+using Boundary = std::variant<
+    RectBoundingArea,
+    CircleBoundingArea,
+    CapsuleBoundingArea,
+    PolygonBoundingArea,
+    AnnulusBoundingArea
+>;
+
+void getBoundaryBounds(const Boundary& boundary, glm::vec2& min_corner, glm::vec2& max_corner);
+float getBoundaryClearance(const Boundary& boundary, glm::vec2 p);
+void getBoundarySpans(const Boundary& boundary, float y, std::vector<glm::vec2>& spans);
+
+// type id is the variant index + 1, so 0 can mean "no boundary"
+uint32_t getBoundaryTypeId(const Boundary& boundary);
+void getBoundaryParams(const Boundary& boundary, std::vector<float>& params);
+bool makeBoundary(uint32_t type_id, const std::vector<float>& params, Boundary& boundary);
+
+#endif
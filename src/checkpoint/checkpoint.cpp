@@ -0,0 +1,382 @@
+#define GLM_ENABLE_EXPERIMENTAL
+
+#include <string>
+#include <vector>
+#include <optional>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <cmath>
+#include <iostream>
+#include <glm/glm.hpp>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "../particleStore/particleStore.hpp"
+#include "../boundaries/boundaries.hpp"
+
+#include "checkpoint.hpp"
+
+namespace {
+    const char MAGIC[8] = {'P', 'S', 'I', 'M', 'C', 'K', 'P', 'T'};
+    const uint64_t ARRAY_ALIGNMENT = 64;
+
+    enum ArrayId : uint32_t {
+        X = 1,
+        Y,
+        LAST_X,
+        LAST_Y,
+        ACC_X,
+        ACC_Y,
+        RADIUS,
+        MASS,
+        REST_STEPS,
+        BOUNDARY_PARAMS = 100
+    };
+
+    struct ArrayBinding {
+        ArrayId id;
+        std::vector<float> ParticleStore::* field;
+    };
+
+    const ArrayBinding ARRAYS[] = {
+        {X, &ParticleStore::x},
+        {Y, &ParticleStore::y},
+        {LAST_X, &ParticleStore::last_x},
+        {LAST_Y, &ParticleStore::last_y},
+        {ACC_X, &ParticleStore::acc_x},
+        {ACC_Y, &ParticleStore::acc_y},
+        {RADIUS, &ParticleStore::radius},
+        {MASS, &ParticleStore::mass},
+    };
+    const uint32_t ARRAY_COUNT = sizeof(ARRAYS) / sizeof(ARRAYS[0]);
+    // the float arrays, then the rest steps, then the boundary parameters
+    const uint32_t REST_STEPS_ARRAY = ARRAY_COUNT;
+    const uint32_t BOUNDARY_ARRAY = ARRAY_COUNT + 1;
+
+    bool isLittleEndian() {
+        const uint16_t probe = 1;
+        uint8_t first;
+        std::memcpy(&first, &probe, 1);
+        return first == 1;
+    }
+
+    uint64_t alignUp(uint64_t value) {
+        return (value + ARRAY_ALIGNMENT - 1) & ~(ARRAY_ALIGNMENT - 1);
+    }
+
+    // written so that a crafted offset or size cannot wrap around past the end
+    bool isInFile(const CheckpointArray& entry, size_t file_size) {
+        return entry.offset <= file_size && entry.size <= file_size - entry.offset;
+    }
+
+    // the solver divides by step_dt and substeps, so a bad file must not reach it
+    bool areSettingsValid(const CheckpointSettings& settings) {
+        return std::isfinite(settings.gravity_x) && std::isfinite(settings.gravity_y)
+            && std::isfinite(settings.step_dt) && settings.step_dt > 0.0f
+            && settings.substeps > 0
+            && std::isfinite(settings.bounce_coefficient)
+            && std::isfinite(settings.solver_radius) && settings.solver_radius > 0.0f
+            && std::isfinite(settings.sim_time);
+    }
+}
+
+MappedFile::MappedFile()
+: mapping(nullptr)
+, length(0)
+#ifdef _WIN32
+, file_handle(INVALID_HANDLE_VALUE)
+, mapping_handle(nullptr)
+#else
+, file_descriptor(-1)
+#endif
+{}
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+const uint8_t* MappedFile::data() const {
+    return mapping;
+}
+
+size_t MappedFile::size() const {
+    return length;
+}
+
+#ifdef _WIN32
+bool MappedFile::open(const std::string& path) {
+    close();
+    file_handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file_handle == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file_handle, &file_size) || file_size.QuadPart == 0) {
+        close();
+        return false;
+    }
+    mapping_handle = CreateFileMappingA(file_handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping_handle) {
+        close();
+        return false;
+    }
+    mapping = static_cast<const uint8_t*>(MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0));
+    length = static_cast<size_t>(file_size.QuadPart);
+    if (!mapping) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void MappedFile::close() {
+    if (mapping) {
+        UnmapViewOfFile(mapping);
+    }
+    if (mapping_handle) {
+        CloseHandle(mapping_handle);
+    }
+    if (file_handle != INVALID_HANDLE_VALUE) {
+        CloseHandle(file_handle);
+    }
+    mapping = nullptr;
+    mapping_handle = nullptr;
+    file_handle = INVALID_HANDLE_VALUE;
+    length = 0;
+}
+#else
+bool MappedFile::open(const std::string& path) {
+    close();
+    file_descriptor = ::open(path.c_str(), O_RDONLY);
+    if (file_descriptor < 0) {
+        return false;
+    }
+    struct stat info;
+    if (fstat(file_descriptor, &info) != 0 || info.st_size == 0) {
+        close();
+        return false;
+    }
+    length = static_cast<size_t>(info.st_size);
+    void* address = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, file_descriptor, 0);
+    if (address == MAP_FAILED) {
+        close();
+        return false;
+    }
+    mapping = static_cast<const uint8_t*>(address);
+    // the restore reads every array front to back once
+    madvise(address, length, MADV_SEQUENTIAL | MADV_WILLNEED);
+    return true;
+}
+
+void MappedFile::close() {
+    if (mapping) {
+        munmap(const_cast<uint8_t*>(mapping), length);
+    }
+    if (file_descriptor >= 0) {
+        ::close(file_descriptor);
+    }
+    mapping = nullptr;
+    file_descriptor = -1;
+    length = 0;
+}
+#endif
+
+bool writeCheckpoint(const std::string& path, const ParticleStore& store, const CheckpointSettings& settings, const Boundary* boundary) {
+    if (!isLittleEndian()) {
+        std::cerr << "Checkpoints are little-endian only" << std::endl;
+        return false;
+    }
+
+    std::vector<float> boundary_params;
+    if (boundary) {
+        getBoundaryParams(*boundary, boundary_params);
+    }
+
+    CheckpointHeader header = {};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = CHECKPOINT_VERSION;
+    header.header_size = sizeof(CheckpointHeader);
+    header.particle_count = store.size();
+    header.array_count = BOUNDARY_ARRAY + (boundary ? 1 : 0);
+    header.settings = settings;
+    header.boundary_type = boundary ? getBoundaryTypeId(*boundary) : 0;
+    header.boundary_param_count = static_cast<uint32_t>(boundary_params.size());
+
+    std::vector<CheckpointArray> table(header.array_count);
+    std::vector<const void*> sources(header.array_count);
+    const uint64_t table_size = table.size() * sizeof(CheckpointArray);
+    uint64_t offset = alignUp(sizeof(header) + table_size);
+    for (uint32_t a = 0; a < header.array_count; ++a) {
+        table[a].element_size = sizeof(float);
+        table[a].offset = offset;
+        table[a].size = store.size() * sizeof(float);
+        if (a == BOUNDARY_ARRAY) {
+            table[a].id = BOUNDARY_PARAMS;
+            table[a].size = boundary_params.size() * sizeof(float);
+            sources[a] = boundary_params.data();
+        }
+        else if (a == REST_STEPS_ARRAY) {
+            table[a].id = REST_STEPS;
+            table[a].element_size = sizeof(uint32_t);
+            sources[a] = store.rest_steps.data();
+        }
+        else {
+            table[a].id = ARRAYS[a].id;
+            sources[a] = (store.*(ARRAYS[a].field)).data();
+        }
+        offset = alignUp(offset + table[a].size);
+    }
+
+    const std::string temp_path = path + ".tmp";
+    FILE* file = std::fopen(temp_path.c_str(), "wb");
+    if (!file) {
+        std::cerr << "Could not open " << temp_path << std::endl;
+        return false;
+    }
+
+    static const uint8_t padding[ARRAY_ALIGNMENT] = {};
+    bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1
+           && std::fwrite(table.data(), 1, table_size, file) == table_size;
+    uint64_t written = sizeof(header) + table_size;
+    for (uint32_t a = 0; a < header.array_count && ok; ++a) {
+        ok = std::fwrite(padding, 1, table[a].offset - written, file) == table[a].offset - written;
+        ok = ok && std::fwrite(sources[a], 1, table[a].size, file) == table[a].size;
+        written = table[a].offset + table[a].size;
+    }
+    ok = std::fclose(file) == 0 && ok;
+
+    if (ok) {
+#ifdef _WIN32
+        ok = MoveFileExA(temp_path.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+        ok = std::rename(temp_path.c_str(), path.c_str()) == 0;
+#endif
+    }
+    if (!ok) {
+        std::cerr << "Failed to write checkpoint " << path << std::endl;
+        std::remove(temp_path.c_str());
+    }
+    return ok;
+}
+
+bool readCheckpoint(const std::string& path, ParticleStore& store, CheckpointSettings& settings, std::optional<Boundary>& boundary) {
+    MappedFile file;
+    if (!file.open(path)) {
+        std::cerr << "Could not map " << path << std::endl;
+        return false;
+    }
+
+    CheckpointHeader header;
+    if (file.size() < sizeof(header)) {
+        std::cerr << path << " is too small to be a checkpoint" << std::endl;
+        return false;
+    }
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || !isLittleEndian()) {
+        std::cerr << path << " is not a checkpoint for this platform" << std::endl;
+        return false;
+    }
+    if (header.version < CHECKPOINT_MIN_VERSION || header.header_size < sizeof(header)) {
+        std::cerr << path << " has unsupported checkpoint version " << header.version << std::endl;
+        return false;
+    }
+
+    if (!areSettingsValid(header.settings)) {
+        std::cerr << path << " has invalid solver settings" << std::endl;
+        return false;
+    }
+
+    // bounds count * sizeof(float) well below overflow before any table entry is checked
+    const uint64_t count = header.particle_count;
+    if (count > file.size() / sizeof(float)) {
+        std::cerr << path << " is truncated" << std::endl;
+        return false;
+    }
+    const uint64_t table_start = header.header_size;
+    const uint64_t table_end = table_start + static_cast<uint64_t>(header.array_count) * sizeof(CheckpointArray);
+    if (table_end > file.size()) {
+        std::cerr << path << " is truncated" << std::endl;
+        return false;
+    }
+
+    // validate everything before touching the store, so a bad file leaves it intact
+    const float* sources[ARRAY_COUNT] = {};
+    const uint32_t* rest_steps_source = nullptr;
+    const float* boundary_source = nullptr;
+    for (uint32_t t = 0; t < header.array_count; ++t) {
+        CheckpointArray entry;
+        std::memcpy(&entry, file.data() + table_start + t * sizeof(CheckpointArray), sizeof(entry));
+        if (entry.id == BOUNDARY_PARAMS) {
+            if (entry.element_size != sizeof(float) || entry.size != header.boundary_param_count * sizeof(float)
+                || entry.offset % alignof(float) != 0 || !isInFile(entry, file.size())) {
+                std::cerr << path << " has a corrupt array table" << std::endl;
+                return false;
+            }
+            boundary_source = reinterpret_cast<const float*>(file.data() + entry.offset);
+            continue;
+        }
+        if (entry.id == REST_STEPS) {
+            if (entry.element_size != sizeof(uint32_t) || entry.size != count * sizeof(uint32_t)
+                || entry.offset % alignof(uint32_t) != 0 || !isInFile(entry, file.size())) {
+                std::cerr << path << " has a corrupt array table" << std::endl;
+                return false;
+            }
+            rest_steps_source = reinterpret_cast<const uint32_t*>(file.data() + entry.offset);
+            continue;
+        }
+        for (uint32_t a = 0; a < ARRAY_COUNT; ++a) {
+            if (ARRAYS[a].id != entry.id) {
+                continue;
+            }
+            if (entry.element_size != sizeof(float) || entry.size != count * sizeof(float)
+                || entry.offset % alignof(float) != 0 || !isInFile(entry, file.size())) {
+                std::cerr << path << " has a corrupt array table" << std::endl;
+                return false;
+            }
+            sources[a] = reinterpret_cast<const float*>(file.data() + entry.offset);
+        }
+    }
+    for (uint32_t a = 0; a < ARRAY_COUNT; ++a) {
+        if (!sources[a]) {
+            std::cerr << path << " is missing particle array " << ARRAYS[a].id << std::endl;
+            return false;
+        }
+    }
+    if (!rest_steps_source) {
+        std::cerr << path << " is missing particle array " << REST_STEPS << std::endl;
+        return false;
+    }
+
+    std::optional<Boundary> restored_boundary;
+    if (header.boundary_type != 0) {
+        std::vector<float> params;
+        if (boundary_source) {
+            params.assign(boundary_source, boundary_source + header.boundary_param_count);
+        }
+        Boundary shape;
+        if (!makeBoundary(header.boundary_type, params, shape)) {
+            std::cerr << path << " has an invalid boundary of type " << header.boundary_type << std::endl;
+            return false;
+        }
+        restored_boundary = std::move(shape);
+    }
+
+    // ParticleStore owns its arrays, so restoring is one bulk copy per array
+    // straight out of the page cache
+    for (uint32_t a = 0; a < ARRAY_COUNT; ++a) {
+        (store.*(ARRAYS[a].field)).assign(sources[a], sources[a] + count);
+    }
+    store.resetHandles();
+    store.rest_steps.assign(rest_steps_source, rest_steps_source + count);
+    settings = header.settings;
+    boundary = std::move(restored_boundary);
+    return true;
+}
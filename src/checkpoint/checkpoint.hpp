@@ -0,0 +1,89 @@
+#define GLM_ENABLE_EXPERIMENTAL
+#ifndef CHECKPOINT_HPP
+#define CHECKPOINT_HPP
+
+#include <string>
+#include <optional>
+#include <cstdint>
+#include <cstddef>
+
+#include "../particleStore/particleStore.hpp"
+#include "../boundaries/boundaries.hpp"
+
+// Checkpoint file layout (version 3, little-endian, every array 64-byte aligned):
+//   CheckpointHeader
+//   CheckpointArray table[array_count]  (one per ParticleStore field, plus the
+//                                        boundary parameters when there is a boundary)
+//   array data
+// Arrays are identified by id, so later versions can add fields and readers skip
+// ids they do not know; a later header may also grow, and the table starts after
+// header_size bytes. Versions 1 and 2 lack the rest counters and schedules and are
+// not read.
+
+const uint32_t CHECKPOINT_VERSION = 3;
+const uint32_t CHECKPOINT_MIN_VERSION = 3;
+
+struct CheckpointSettings {
+    float gravity_x;
+    float gravity_y;
+    float step_dt;
+    int32_t substeps;
+    float bounce_coefficient;
+    float solver_radius;
+    double sim_time;
+    uint64_t step_count;
+    // when the periodic passes run next, so a restored run continues exactly
+    uint64_t next_disorder_check;
+    uint64_t last_reorder_step;
+    uint64_t next_island_check;
+};
+
+struct CheckpointHeader {
+    char magic[8];     // "PSIMCKPT"
+    uint32_t version;
+    uint32_t header_size;
+    uint64_t particle_count;
+    uint32_t array_count;
+    uint32_t reserved;
+    CheckpointSettings settings;
+    uint32_t boundary_type;          // 0 none, otherwise getBoundaryTypeId()
+    uint32_t boundary_param_count;   // floats in the boundary parameter array
+};
+
+struct CheckpointArray {
+    uint32_t id;
+    uint32_t element_size;
+    uint64_t offset;
+    uint64_t size;
+};
+
+// Read-only view of a whole file through the OS page cache
+class MappedFile {
+    public:
+        MappedFile();
+        ~MappedFile();
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        bool open(const std::string& path);
+        void close();
+
+        const uint8_t* data() const;
+        size_t size() const;
+
+    private:
+        const uint8_t* mapping;
+        size_t length;
+#ifdef _WIN32
+        void* file_handle;
+        void* mapping_handle;
+#else
+        int file_descriptor;
+#endif
+};
+
+// Writes to path.tmp and renames it over path, so a crash mid-save keeps the old file
+bool writeCheckpoint(const std::string& path, const ParticleStore& store, const CheckpointSettings& settings, const Boundary* boundary);
+bool readCheckpoint(const std::string& path, ParticleStore& store, CheckpointSettings& settings, std::optional<Boundary>& boundary);
+
+#endif
@@ -0,0 +1,16 @@
+#include <vector>
+#include <mutex>
+
+#include "commandQueue.hpp"
+
+void CommandQueue::push(const SolverCommand& command) {
+    std::lock_guard<std::mutex> lock(mutex);
+    pending.push_back(command);
+}
+
+void CommandQueue::drain(std::vector<SolverCommand>& out) {
+    out.clear();
+    std::lock_guard<std::mutex> lock(mutex);
+    // swapping keeps both vectors' capacity, so steady state never allocates
+    out.swap(pending);
+}
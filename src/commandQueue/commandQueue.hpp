@@ -0,0 +1,42 @@
+#define GLM_ENABLE_EXPERIMENTAL
+#ifndef COMMAND_QUEUE_HPP
+#define COMMAND_QUEUE_HPP
+
+#include <vector>
+#include <mutex>
+#include <glm/glm.hpp>
+
+#include "../particleStore/particleStore.hpp"
+#include "../forceField/forceField.hpp"
+
+enum class CommandType {
+    Spawn,
+    ForceField,
+    Remove
+};
+
+struct SolverCommand {
+    CommandType type;
+    glm::vec2 position;
+    glm::vec2 velocity;
+    ParticleHandle handle = ParticleHandle(); // Remove only
+    float radius = 0.0f;                      // Spawn only
+    ForceField field = ForceField();          // ForceField only
+};
+
+// Multi-producer queue of solver mutations. Any thread can push; the update thread
+// drains it at a step boundary, so the particle arrays are only ever resized by the
+// thread that steps them. The lock is held just long enough to append or swap.
+class CommandQueue {
+    public:
+        void push(const SolverCommand& command);
+
+        // moves the pending commands into out (cleared first) and empties the queue
+        void drain(std::vector<SolverCommand>& out);
+
+    private:
+        std::mutex mutex;
+        std::vector<SolverCommand> pending;
+};
+
+#endif
@@ -12,9 +12,9 @@ class GraphicsConstants {
 class SolverConstants {
     public:
         static const int MAX_OBJECTS;
-        static const float SPAWN_DELAY;
         static const glm::vec2 SPAWN_POSITION;
         static const float SPAWN_VELOCITY;
+        static const float SPAWN_WIDTH;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,159 @@
+#define GLM_ENABLE_EXPERIMENTAL
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <glm/glm.hpp>
+
+#include "../particleStore/particleStore.hpp"
+
+#include "contactCache.hpp"
+
+namespace {
+    const uint64_t EMPTY_KEY = ~0ull;
+
+    uint64_t getPairKey(uint32_t i, uint32_t j) {
+        // either order finds the pair
+        return i < j ? (static_cast<uint64_t>(i) << 32) | j : (static_cast<uint64_t>(j) << 32) | i;
+    }
+
+    size_t hashKey(uint64_t key) {
+        key ^= key >> 33;
+        key *= 0xff51afd7ed558ccdull;
+        key ^= key >> 33;
+        return static_cast<size_t>(key);
+    }
+}
+
+void ContactCache::reserve(size_t num_objects) {
+    build_x.reserve(num_objects);
+    build_y.reserve(num_objects);
+}
+
+void ContactCache::clear() {
+    for (size_t block = 0; block < block_count; ++block) {
+        blocks[block].clear();
+    }
+    block_count = 0;
+    passes.clear();
+    contact_count = 0;
+    built = false;
+    lambda_keys.clear();
+    lambda_mask = 0;
+}
+
+void ContactCache::invalidate() {
+    built = false;
+}
+
+void ContactCache::beginBuild() {
+    size_t active = 0;
+    for (size_t block = 0; block < block_count; ++block) {
+        for (const Contact& contact : blocks[block]) {
+            active += contact.lambda > 0.0f;
+        }
+    }
+
+    // at most half full, so probe runs stay short
+    size_t capacity = 0;
+    if (active > 0) {
+        capacity = 16;
+        while (capacity < 2 * active) {
+            capacity *= 2;
+        }
+    }
+    lambda_keys.assign(capacity, EMPTY_KEY);
+    lambda_values.resize(capacity);
+    lambda_mask = capacity > 0 ? capacity - 1 : 0;
+    for (size_t block = 0; block < block_count; ++block) {
+        for (const Contact& contact : blocks[block]) {
+            if (contact.lambda <= 0.0f) {
+                continue;
+            }
+            const uint64_t key = getPairKey(contact.i, contact.j);
+            size_t slot = hashKey(key) & lambda_mask;
+            while (lambda_keys[slot] != EMPTY_KEY && lambda_keys[slot] != key) {
+                slot = (slot + 1) & lambda_mask;
+            }
+            lambda_keys[slot] = key;
+            lambda_values[slot] = contact.lambda;
+        }
+        blocks[block].clear();
+    }
+    block_count = 0;
+    passes.clear();
+    contact_count = 0;
+}
+
+size_t ContactCache::addPass(size_t level, bool cross_level, size_t pass_blocks) {
+    const size_t first_block = block_count;
+    block_count += pass_blocks;
+    if (blocks.size() < block_count) {
+        blocks.resize(block_count);
+    }
+    passes.push_back({level, cross_level, first_block});
+    return first_block;
+}
+
+std::vector<Contact>& ContactCache::getBlock(size_t block) {
+    return blocks[block];
+}
+
+const std::vector<Contact>& ContactCache::getBlock(size_t block) const {
+    return blocks[block];
+}
+
+float ContactCache::findLambda(uint32_t i, uint32_t j) const {
+    if (lambda_keys.empty()) {
+        return 0.0f;
+    }
+    const uint64_t key = getPairKey(i, j);
+    for (size_t slot = hashKey(key) & lambda_mask; lambda_keys[slot] != EMPTY_KEY; slot = (slot + 1) & lambda_mask) {
+        if (lambda_keys[slot] == key) {
+            return lambda_values[slot];
+        }
+    }
+    return 0.0f;
+}
+
+void ContactCache::endBuild() {
+    contact_count = 0;
+    for (size_t block = 0; block < block_count; ++block) {
+        contact_count += blocks[block].size();
+    }
+    built = true;
+}
+
+const std::vector<ContactCache::Pass>& ContactCache::getPasses() const {
+    return passes;
+}
+
+size_t ContactCache::getContactCount() const {
+    return contact_count;
+}
+
+bool ContactCache::isBuilt() const {
+    return built;
+}
+
+void ContactCache::resizePositions(size_t num_objects) {
+    build_x.resize(num_objects);
+    build_y.resize(num_objects);
+}
+
+void ContactCache::recordPositions(const ParticleStore& objects, size_t start, size_t end) {
+    std::copy(objects.x.begin() + start, objects.x.begin() + end, build_x.begin() + start);
+    std::copy(objects.y.begin() + start, objects.y.begin() + end, build_y.begin() + start);
+}
+
+float ContactCache::getMaxDisplacement2(const ParticleStore& objects, size_t start, size_t end) const {
+    const float* xs = objects.x.data();
+    const float* ys = objects.y.data();
+    float max_displacement2 = 0.0f;
+    for (size_t i = start; i < end; ++i) {
+        const float dx = xs[i] - build_x[i];
+        const float dy = ys[i] - build_y[i];
+        max_displacement2 = std::max(max_displacement2, dx * dx + dy * dy);
+    }
+    return max_displacement2;
+}
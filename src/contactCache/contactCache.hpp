@@ -0,0 +1,82 @@
+#define GLM_ENABLE_EXPERIMENTAL
+#ifndef CONTACT_CACHE_HPP
+#define CONTACT_CACHE_HPP
+
+#include <vector>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+#include "../particleStore/particleStore.hpp"
+
+// A pair of particles close enough to touch before the cache is rebuilt
+struct Contact {
+    uint32_t i;
+    uint32_t j;
+    float lambda; // separation applied along the normal over the current substep, >= 0
+};
+
+// per step, from the iterative contact solver
+struct ContactStats {
+    size_t contacts = 0;       // cached at the end of the step
+    size_t rebuilds = 0;
+    int iterations = 0;        // per substep
+    // deepest overlap met by the first and by the last iteration, over the substeps
+    float initial_residual = 0.0f;
+    float final_residual = 0.0f;
+};
+
+// Contacts kept across substeps. They are gathered from the grid with a skin, in
+// blocks that the solver relaxes colour by colour, and stay valid until some particle
+// has moved half the skin from where it was at the build. Each rebuild carries the
+// lambdas of pairs that are still in contact over, so the solver can warm start.
+class ContactCache {
+    public:
+        // one grid pass: same-level pairs of a level, or its particles against the finer levels
+        struct Pass {
+            size_t level;
+            bool cross_level;
+            size_t first_block;
+        };
+
+        void reserve(size_t num_objects);
+        // forgets every contact and lambda, e.g. once particle indices changed
+        void clear();
+        // the next build still carries the lambdas over
+        void invalidate();
+
+        // Building: beginBuild keeps the current lambdas for findLambda, addPass hands
+        // out blocks that can be filled in parallel, and endBuild counts the contacts.
+        void beginBuild();
+        size_t addPass(size_t level, bool cross_level, size_t block_count);
+        std::vector<Contact>& getBlock(size_t block);
+        // lambda of the pair at the last build, 0 when it was not in contact
+        float findLambda(uint32_t i, uint32_t j) const;
+        void endBuild();
+
+        const std::vector<Pass>& getPasses() const;
+        const std::vector<Contact>& getBlock(size_t block) const;
+        size_t getContactCount() const;
+        bool isBuilt() const;
+
+        // positions at the build; the largest squared displacement since, over [start, end)
+        void recordPositions(const ParticleStore& objects, size_t start, size_t end);
+        void resizePositions(size_t num_objects);
+        float getMaxDisplacement2(const ParticleStore& objects, size_t start, size_t end) const;
+
+    private:
+        std::vector<std::vector<Contact>> blocks; // only grows; block_count are in use
+        size_t block_count = 0;
+        std::vector<Pass> passes;
+        size_t contact_count = 0;
+        bool built = false;
+
+        // open addressing table of the lambdas at the last build
+        std::vector<uint64_t> lambda_keys;
+        std::vector<float> lambda_values;
+        size_t lambda_mask = 0;
+
+        std::vector<float> build_x;
+        std::vector<float> build_y;
+};
+
+#endif
@@ -0,0 +1,170 @@
+#define GLM_ENABLE_EXPERIMENTAL
+
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include <glm/glm.hpp>
+
+#include "../particle/particle.hpp"
+#include "../particleStore/particleStore.hpp"
+#include "../solver/solver.hpp"
+
+#include "emitter.hpp"
+
+namespace {
+    const float DEFAULT_SPACING = 2.2f; // in particle radii
+}
+
+Pcg32::Pcg32(uint64_t seed, uint64_t stream)
+: state(0)
+, increment((stream << 1u) | 1u)
+{
+    next();
+    state += seed;
+    next();
+}
+
+uint32_t Pcg32::next(){
+    const uint64_t old_state = state;
+    state = old_state * 6364136223846793005ull + increment;
+    const uint32_t xorshifted = static_cast<uint32_t>(((old_state >> 18u) ^ old_state) >> 27u);
+    const uint32_t rotation = static_cast<uint32_t>(old_state >> 59u);
+    return (xorshifted >> rotation) | (xorshifted << ((32u - rotation) & 31u));
+}
+
+float Pcg32::nextFloat(){
+    // top 24 bits, so every value is exactly representable and below 1
+    return static_cast<float>(next() >> 8) * (1.0f / 16777216.0f);
+}
+
+float Pcg32::range(float min, float max){
+    return min + (max - min) * nextFloat();
+}
+
+Emitter::Emitter(const EmitterConfig& config_, float particle_radius)
+: config(config_)
+, min_radius(config_.min_radius > 0.0f ? config_.min_radius : particle_radius)
+, max_radius(std::max(min_radius, config_.max_radius))
+, rng(config_.seed)
+{
+    buildSlots();
+}
+
+const EmitterConfig& Emitter::getConfig() const {
+    return config;
+}
+
+size_t Emitter::getEmitted() const {
+    return emitted;
+}
+
+bool Emitter::isExhausted() const {
+    return config.total > 0 && emitted >= config.total;
+}
+
+void Emitter::buildSlots(){
+    const float spacing = std::max(config.spacing > 0.0f ? config.spacing : DEFAULT_SPACING * max_radius, 2.0f * max_radius);
+    slots.clear();
+    if (config.shape == EmitterShape::Point){
+        slots.push_back(config.position);
+    }
+    else if (config.shape == EmitterShape::Line){
+        const glm::vec2 offset = config.end - config.position;
+        const float length = glm::length(offset);
+        const int count = static_cast<int>(length / spacing) + 1;
+        const glm::vec2 direction = length > 0.0f ? offset / length : glm::vec2(0.0f);
+        for (int k = 0; k < count; ++k){
+            slots.push_back(config.position + direction * (k * spacing));
+        }
+    }
+    else if (config.shape == EmitterShape::Disk){
+        // hexagonal rows keep every neighbour exactly one spacing away
+        const float row_pitch = spacing * 0.8660254f;
+        const int rows = static_cast<int>(config.radius / row_pitch);
+        const int columns = static_cast<int>(config.radius / spacing) + 1;
+        for (int row = -rows; row <= rows; ++row){
+            const float y = row * row_pitch;
+            const float shift = (row & 1) ? 0.5f * spacing : 0.0f;
+            for (int column = -columns; column <= columns; ++column){
+                const float x = column * spacing + shift;
+                if (x * x + y * y <= config.radius * config.radius){
+                    slots.push_back(config.position + glm::vec2(x, y));
+                }
+            }
+        }
+    }
+    else {
+        const glm::vec2 min_corner = glm::min(config.position, config.end);
+        const glm::vec2 max_corner = glm::max(config.position, config.end);
+        for (float y = min_corner.y; y <= max_corner.y; y += spacing){
+            for (float x = min_corner.x; x <= max_corner.x; x += spacing){
+                slots.push_back(glm::vec2(x, y));
+            }
+        }
+    }
+    batch.reserve(slots.size());
+}
+
+size_t Emitter::emit(Solver& solver){
+    if (slots.empty() || isExhausted()){
+        return 0;
+    }
+    ParticleStore& objects = solver.getObjects();
+    const float step_dt = solver.getStepdt();
+
+    size_t budget = slots.size();
+    if (config.rate > 0.0f){
+        // a blocked emitter owes at most one pass over its slots, not an ever growing burst
+        pending = std::min(pending + config.rate * step_dt, static_cast<float>(slots.size()));
+        budget = static_cast<size_t>(pending);
+    }
+    if (config.total > 0){
+        budget = std::min(budget, config.total - emitted);
+    }
+    const size_t max_objects = solver.getMaxObjects();
+    budget = std::min(budget, max_objects > objects.size() ? max_objects - objects.size() : 0);
+    if (budget == 0){
+        return 0;
+    }
+
+    // Every slot is checked before any particle is appended, so the checks only see
+    // the grid and the particles added earlier in this step, never this batch.
+    batch.clear();
+    const size_t first_slot = rng.next() % slots.size();
+    for (size_t k = 0; k < slots.size() && batch.size() < budget; ++k){
+        const glm::vec2& slot = slots[(first_slot + k) % slots.size()];
+        if (solver.isSpaceFree(slot, max_radius)){
+            batch.push_back(slot);
+        }
+    }
+    if (config.rate > 0.0f){
+        pending -= static_cast<float>(batch.size());
+    }
+    if (batch.empty()){
+        return 0;
+    }
+
+    const float substep_dt = solver.getSubstepdt();
+    const float speed = glm::length(config.velocity);
+    const float angle = std::atan2(config.velocity.y, config.velocity.x);
+    const size_t first = objects.addBatch(batch.size(), Particle(glm::vec2(0.0f), min_radius));
+    const bool sized = max_radius > min_radius;
+    for (size_t k = 0; k < batch.size(); ++k){
+        const float particle_speed = speed * (1.0f + rng.range(-config.speed_spread, config.speed_spread));
+        const float particle_angle = angle + rng.range(-config.angle_spread, config.angle_spread);
+        const glm::vec2 displacement = particle_speed * substep_dt * glm::vec2(std::cos(particle_angle), std::sin(particle_angle));
+        const size_t i = first + k;
+        objects.x[i] = batch[k].x;
+        objects.y[i] = batch[k].y;
+        objects.last_x[i] = batch[k].x - displacement.x;
+        objects.last_y[i] = batch[k].y - displacement.y;
+        if (sized){
+            const Particle particle(batch[k], rng.range(min_radius, max_radius));
+            objects.radius[i] = particle.radius;
+            objects.mass[i] = particle.mass;
+        }
+    }
+    emitted += batch.size();
+    return batch.size();
+}
@@ -0,0 +1,32 @@
+#define GLM_ENABLE_EXPERIMENTAL
+
+#include <algorithm>
+#include <cmath>
+#include <glm/glm.hpp>
+
+#include "forceField.hpp"
+
+bool ForceField::isBounded() const {
+    return radius > 0.0f;
+}
+
+glm::vec2 ForceField::getVelocityChange(glm::vec2 particle_position, glm::vec2 particle_velocity, float dt) const {
+    const glm::vec2 offset = particle_position - position;
+    const float dist2 = offset.x * offset.x + offset.y * offset.y;
+    if (isBounded() && dist2 >= radius * radius) {
+        return glm::vec2(0.0f);
+    }
+    const float falloff = isBounded() ? 1.0f - std::sqrt(dist2) / radius : 1.0f;
+
+    switch (type) {
+        case ForceFieldType::Radial:
+            return -offset * (strength * falloff * dt);
+        case ForceFieldType::Vortex:
+            return glm::vec2(-offset.y, offset.x) * (strength * falloff * dt);
+        case ForceFieldType::Wind:
+            return (velocity - particle_velocity) * std::clamp(strength * dt, 0.0f, 1.0f);
+        case ForceFieldType::Drag:
+            return -particle_velocity * std::clamp(strength * dt, 0.0f, 1.0f);
+    }
+    return glm::vec2(0.0f);
+}
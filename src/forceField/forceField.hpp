@@ -0,0 +1,33 @@
+#define GLM_ENABLE_EXPERIMENTAL
+#ifndef FORCE_FIELD_HPP
+#define FORCE_FIELD_HPP
+
+#include <glm/glm.hpp>
+
+enum class ForceFieldType {
+    Radial, // towards position; a negative strength pushes away
+    Vortex, // around position, counter-clockwise for a positive strength
+    Wind,   // particles pick up velocity
+    Drag    // particles lose their velocity
+};
+
+// A force on the particles whose centre lies in the disc of radius around position,
+// or on every particle when radius is 0.
+// Radial and Vortex accelerate a particle by strength (per second squared) times its
+// distance to position, fading linearly to nothing at the edge of the disc.
+// Wind and Drag close the gap between a particle's velocity and velocity (zero for
+// Drag) at a rate of strength per second, uniformly over the disc.
+struct ForceField {
+    ForceFieldType type = ForceFieldType::Radial;
+    glm::vec2 position = glm::vec2(0.0f);
+    float radius = 0.0f;
+    float strength = 0.0f;
+    glm::vec2 velocity = glm::vec2(0.0f); // Wind only, in units per second
+
+    bool isBounded() const;
+    // what the field adds to the velocity of a particle at position over dt; zero
+    // outside the disc. Wind and Drag never overshoot velocity, however long dt is.
+    glm::vec2 getVelocityChange(glm::vec2 particle_position, glm::vec2 particle_velocity, float dt) const;
+};
+
+#endif
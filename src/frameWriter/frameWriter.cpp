@@ -0,0 +1,263 @@
+#include <vector>
+#include <array>
+#include <string>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+#include <iostream>
+
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#endif
+
+#include "frameWriter.hpp"
+
+namespace {
+    const size_t MAX_STORED_BLOCK = 65535;
+
+    const size_t ADLER_NMAX = 5552; // most bytes before the adler sums can overflow 32 bits
+    const int MAX_NUMBER_WIDTH = 32;
+
+    std::array<uint32_t, 256> makeCrcTable() {
+        std::array<uint32_t, 256> table;
+        for (uint32_t n = 0; n < 256; ++n) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            }
+            table[n] = c;
+        }
+        return table;
+    }
+
+    uint32_t crc32(const uint8_t* data, size_t size) {
+        static const std::array<uint32_t, 256> table = makeCrcTable();
+        uint32_t crc = 0xffffffffu;
+        for (size_t i = 0; i < size; ++i) {
+            crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+        }
+        return ~crc;
+    }
+
+    uint32_t adler32(const uint8_t* data, size_t size) {
+        uint32_t a = 1, b = 0;
+        while (size > 0) {
+            const size_t block = std::min(size, ADLER_NMAX);
+            for (size_t i = 0; i < block; ++i) {
+                a += data[i];
+                b += a;
+            }
+            a %= 65521;
+            b %= 65521;
+            data += block;
+            size -= block;
+        }
+        return (b << 16) | a;
+    }
+
+    void putBigEndian(std::vector<uint8_t>& out, uint32_t value) {
+        out.push_back(static_cast<uint8_t>(value >> 24));
+        out.push_back(static_cast<uint8_t>(value >> 16));
+        out.push_back(static_cast<uint8_t>(value >> 8));
+        out.push_back(static_cast<uint8_t>(value));
+    }
+
+    void putChunk(std::vector<uint8_t>& out, const char* type, const std::vector<uint8_t>& data) {
+        putBigEndian(out, static_cast<uint32_t>(data.size()));
+        const size_t type_offset = out.size();
+        out.insert(out.end(), type, type + 4);
+        out.insert(out.end(), data.begin(), data.end());
+        putBigEndian(out, crc32(out.data() + type_offset, 4 + data.size()));
+    }
+}
+
+FrameWriter::FrameWriter(FrameFormat format_, const std::string& output_)
+: format(format_)
+, output(output_)
+, per_frame_files(output_.find('%') != std::string::npos)
+, number_width(0)
+, number_padding(' ')
+, stream(nullptr)
+, frame(0)
+{
+    if (per_frame_files && !parsePattern()) {
+        // write fails for every frame rather than guessing at the intended name
+        std::cerr << "Output " << output << " must hold exactly one %d field, like frame_%05d.png" << std::endl;
+        per_frame_files = false;
+    }
+    else if (output == "-") {
+#ifdef _WIN32
+        _setmode(_fileno(stdout), _O_BINARY);
+#endif
+        stream = stdout;
+    }
+    else if (!per_frame_files) {
+        stream = std::fopen(output.c_str(), "wb");
+        if (!stream) {
+            std::cerr << "Could not open " << output << std::endl;
+        }
+    }
+}
+
+FrameWriter::~FrameWriter() {
+    if (stream && stream != stdout) {
+        std::fclose(stream);
+    }
+    else if (stream) {
+        std::fflush(stream);
+    }
+}
+
+bool FrameWriter::parseFormat(const std::string& name, FrameFormat& format) {
+    if (name == "ppm") format = FrameFormat::PPM;
+    else if (name == "png") format = FrameFormat::PNG;
+    else if (name == "raw") format = FrameFormat::Raw;
+    else return false;
+    return true;
+}
+
+bool FrameWriter::parsePattern() {
+    // the path is never handed to printf, so a stray field cannot read past the arguments
+    bool has_number = false;
+    for (size_t i = 0; i < output.size(); ++i) {
+        std::string& part = has_number ? path_suffix : path_prefix;
+        if (output[i] != '%') {
+            part += output[i];
+            continue;
+        }
+        if (++i < output.size() && output[i] == '%') {
+            part += '%';
+            continue;
+        }
+        if (has_number) {
+            return false;
+        }
+        if (i < output.size() && output[i] == '0') {
+            number_padding = '0';
+            ++i;
+        }
+        while (i < output.size() && output[i] >= '0' && output[i] <= '9') {
+            number_width = number_width * 10 + (output[i] - '0');
+            if (number_width > MAX_NUMBER_WIDTH) {
+                return false;
+            }
+            ++i;
+        }
+        if (i >= output.size() || output[i] != 'd') {
+            return false;
+        }
+        has_number = true;
+    }
+    return has_number;
+}
+
+std::string FrameWriter::getFramePath() const {
+    const std::string number = std::to_string(frame);
+    const size_t padding = std::max(0, number_width - static_cast<int>(number.size()));
+    return path_prefix + std::string(padding, number_padding) + number + path_suffix;
+}
+
+int FrameWriter::getFrameCount() const {
+    return frame;
+}
+
+bool FrameWriter::write(const std::vector<uint32_t>& pixels, int width, int height) {
+    FILE* target = stream;
+    if (per_frame_files) {
+        const std::string path = getFramePath();
+        target = std::fopen(path.c_str(), "wb");
+        if (!target) {
+            std::cerr << "Could not open " << path << std::endl;
+            return false;
+        }
+    }
+    if (!target) {
+        return false;
+    }
+
+    bool ok;
+    if (format == FrameFormat::Raw) {
+        // the framebuffer is already RGBA8 byte order on little-endian hosts
+        ok = std::fwrite(pixels.data(), sizeof(uint32_t), pixels.size(), target) == pixels.size();
+    }
+    else {
+        encode(pixels, width, height);
+        ok = std::fwrite(buffer.data(), 1, buffer.size(), target) == buffer.size();
+    }
+
+    if (per_frame_files) {
+        ok = std::fclose(target) == 0 && ok;
+    }
+    ++frame;
+    return ok;
+}
+
+void FrameWriter::encode(const std::vector<uint32_t>& pixels, int width, int height) {
+    buffer.clear();
+    if (format == FrameFormat::PPM) {
+        encodePPM(pixels, width, height);
+    }
+    else {
+        encodePNG(pixels, width, height);
+    }
+}
+
+void FrameWriter::encodePPM(const std::vector<uint32_t>& pixels, int width, int height) {
+    char header[64];
+    const int header_size = std::snprintf(header, sizeof(header), "P6\n%d %d\n255\n", width, height);
+    buffer.resize(header_size + pixels.size() * 3);
+    std::memcpy(buffer.data(), header, header_size);
+    uint8_t* out = buffer.data() + header_size;
+    for (uint32_t pixel : pixels) {
+        *out++ = static_cast<uint8_t>(pixel);
+        *out++ = static_cast<uint8_t>(pixel >> 8);
+        *out++ = static_cast<uint8_t>(pixel >> 16);
+    }
+}
+
+void FrameWriter::encodePNG(const std::vector<uint32_t>& pixels, int width, int height) {
+    // uncompressed: the zlib stream holds stored deflate blocks, so no codec is
+    // needed and encoding costs about a memcpy; re-encode offline if size matters
+    const size_t row_bytes = 1 + static_cast<size_t>(width) * 3;
+    std::vector<uint8_t> raw(row_bytes * height);
+    for (int y = 0; y < height; ++y) {
+        uint8_t* out = raw.data() + y * row_bytes;
+        *out++ = 0; // filter: none
+        const uint32_t* line = pixels.data() + static_cast<size_t>(y) * width;
+        for (int x = 0; x < width; ++x) {
+            *out++ = static_cast<uint8_t>(line[x]);
+            *out++ = static_cast<uint8_t>(line[x] >> 8);
+            *out++ = static_cast<uint8_t>(line[x] >> 16);
+        }
+    }
+
+    std::vector<uint8_t> zlib = {0x78, 0x01};
+    zlib.reserve(raw.size() + raw.size() / MAX_STORED_BLOCK * 5 + 16);
+    for (size_t offset = 0; offset < raw.size() || offset == 0; offset += MAX_STORED_BLOCK) {
+        const size_t length = std::min(MAX_STORED_BLOCK, raw.size() - offset);
+        const bool last = offset + length >= raw.size();
+        zlib.push_back(last ? 1 : 0);
+        zlib.push_back(static_cast<uint8_t>(length));
+        zlib.push_back(static_cast<uint8_t>(length >> 8));
+        zlib.push_back(static_cast<uint8_t>(~length));
+        zlib.push_back(static_cast<uint8_t>(~length >> 8));
+        zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + length);
+        if (last) {
+            break;
+        }
+    }
+    putBigEndian(zlib, adler32(raw.data(), raw.size()));
+
+    std::vector<uint8_t> header;
+    putBigEndian(header, width);
+    putBigEndian(header, height);
+    header.insert(header.end(), {8, 2, 0, 0, 0}); // 8-bit RGB
+
+    static const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+    buffer.insert(buffer.end(), signature, signature + 8);
+    putChunk(buffer, "IHDR", header);
+    putChunk(buffer, "IDAT", zlib);
+    putChunk(buffer, "IEND", {});
+}
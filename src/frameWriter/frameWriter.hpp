@@ -0,0 +1,51 @@
+#ifndef FRAME_WRITER_HPP
+#define FRAME_WRITER_HPP
+
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <cstdint>
+
+enum class FrameFormat {
+    PPM,
+    PNG,
+    Raw // bare RGBA8, e.g. for ffmpeg -f rawvideo -pix_fmt rgba
+};
+
+// Writes RGBA8 frames (R in the low byte, top row first). If the output path
+// contains a frame number field such as frame_%05d.png, each frame gets its own
+// file; the path may hold exactly one %d, with an optional zero flag and width, and
+// %% for a literal percent sign. A path with any other field writes nothing.
+// Otherwise every frame is appended to one stream, and "-" means stdout, so frames
+// can be piped straight into an encoder.
+class FrameWriter {
+    public:
+        FrameWriter(FrameFormat format_, const std::string& output_);
+        ~FrameWriter();
+
+        bool write(const std::vector<uint32_t>& pixels, int width, int height);
+        int getFrameCount() const;
+
+        static bool parseFormat(const std::string& name, FrameFormat& format);
+
+    private:
+        FrameFormat format;
+        std::string output;
+        bool per_frame_files;
+        // per_frame_files: the path around the frame number, padded to number_width
+        std::string path_prefix;
+        std::string path_suffix;
+        int number_width;
+        char number_padding;
+        FILE* stream;
+        int frame;
+        std::vector<uint8_t> buffer;
+
+        bool parsePattern();
+        std::string getFramePath() const;
+        void encode(const std::vector<uint32_t>& pixels, int width, int height);
+        void encodePPM(const std::vector<uint32_t>& pixels, int width, int height);
+        void encodePNG(const std::vector<uint32_t>& pixels, int width, int height);
+};
+
+#endif
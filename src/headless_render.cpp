@@ -0,0 +1,145 @@
+#define GLM_ENABLE_EXPERIMENTAL
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <algorithm>
+#include <cstdlib>
+#include <glm/glm.hpp>
+
+#include "constants/constants.hpp"
+#include "boundaries/boundaries.hpp"
+#include "solver/solver.hpp"
+#include "softwareRenderer/softwareRenderer.hpp"
+#include "frameWriter/frameWriter.hpp"
+
+// Renders the simulation to images without a display or GPU, e.g.
+//   headless_render --particles 50000 --frames 600 --format png --output frames/frame_%05d.png
+//   headless_render --format raw --output - | ffmpeg -f rawvideo -pix_fmt rgba -s 1200x800 -r 60 -i - out.mp4
+// --output none renders without writing, to measure the rasteriser on its own.
+// Progress and timings go to stderr, so stdout can carry the frames.
+//
+// Options: --particles N --frames M --radius R --substeps S --boundary circle|rect
+//          --width W --height H --format ppm|png|raw --output path|-|none --threads T
+
+struct RenderConfig {
+    int particles = 20000;
+    int frames = 120;
+    float radius = 2.0f;
+    int substeps = 8;
+    std::string boundary = "circle";
+    int width = static_cast<int>(GraphicsConstants::SCREEN_WIDTH);
+    int height = static_cast<int>(GraphicsConstants::SCREEN_HEIGHT);
+    std::string format = "ppm";
+    std::string output = "frame_%05d.ppm";
+    int threads = 0; // 0: one per hardware thread
+};
+
+static bool parseArgs(int argc, char** argv, RenderConfig& config){
+    for (int i = 1; i < argc; ++i){
+        const std::string arg = argv[i];
+        if (i + 1 >= argc){
+            std::cerr << "Missing value for " << arg << std::endl;
+            return false;
+        }
+        const std::string value = argv[++i];
+        if (arg == "--particles") config.particles = std::atoi(value.c_str());
+        else if (arg == "--frames") config.frames = std::atoi(value.c_str());
+        else if (arg == "--radius") config.radius = static_cast<float>(std::atof(value.c_str()));
+        else if (arg == "--substeps") config.substeps = std::atoi(value.c_str());
+        else if (arg == "--boundary") config.boundary = value;
+        else if (arg == "--width") config.width = std::atoi(value.c_str());
+        else if (arg == "--height") config.height = std::atoi(value.c_str());
+        else if (arg == "--format") config.format = value;
+        else if (arg == "--output") config.output = value;
+        else if (arg == "--threads") config.threads = std::atoi(value.c_str());
+        else {
+            std::cerr << "Unknown option " << arg << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// Fills the boundary with a loose lattice, row by row from the bottom
+static int spawnLattice(Solver& solver, int count, float radius){
+    glm::vec2 min_corner, max_corner;
+    const Boundary& boundary = *solver.getBoundary();
+    getBoundaryBounds(boundary, min_corner, max_corner);
+
+    const float spacing = 2.2f * radius;
+    int spawned = 0;
+    for (float y = min_corner.y + spacing; y < max_corner.y - spacing && spawned < count; y += spacing){
+        for (float x = min_corner.x + spacing; x < max_corner.x - spacing && spawned < count; x += spacing){
+            if (getBoundaryClearance(boundary, glm::vec2({x, y})) < spacing){
+                continue;
+            }
+            auto obj = solver.addObject(glm::vec2({x, y}));
+            // units per second: up to 24, the stir the lattice had at the default 8 substeps
+            solver.setObjectVelocity(obj, glm::vec2({(spawned % 7) - 3.0f, (spawned % 5) - 2.0f}) * 8.0f);
+            ++spawned;
+        }
+    }
+    return spawned;
+}
+
+int main(int argc, char** argv){
+    RenderConfig config;
+    if (!parseArgs(argc, argv, config)){
+        return 1;
+    }
+
+    FrameFormat format;
+    if (!FrameWriter::parseFormat(config.format, format)){
+        std::cerr << "Unknown format " << config.format << std::endl;
+        return 1;
+    }
+
+    Solver solver(config.radius);
+    solver.setSubsteps(config.substeps);
+    if (config.boundary == "rect"){
+        solver.addBoundary(RectBoundingArea::create(GraphicsConstants::SCREEN_WIDTH, GraphicsConstants::SCREEN_HEIGHT));
+    }
+    else {
+        solver.addBoundary(CircleBoundingArea::create(GraphicsConstants::SCREEN_WIDTH / 2, GraphicsConstants::SCREEN_HEIGHT / 2, GraphicsConstants::SCREEN_HEIGHT / 2));
+    }
+
+    solver.setMaxObjects(config.particles);
+    const int spawned = spawnLattice(solver, config.particles, config.radius);
+    if (spawned < config.particles){
+        std::cerr << "Only " << spawned << " particles of radius " << config.radius << " fit in the boundary" << std::endl;
+    }
+
+    const size_t threads = config.threads > 0 ? config.threads : std::max(1u, std::thread::hardware_concurrency());
+    SoftwareRenderer renderer(config.width, config.height, threads);
+    const bool write_frames = config.output != "none";
+    FrameWriter writer(format, write_frames ? config.output : "-");
+
+    double sim_seconds = 0.0, render_seconds = 0.0, write_seconds = 0.0;
+    for (int frame = 0; frame < config.frames; ++frame){
+        const auto sim_start = std::chrono::steady_clock::now();
+        solver.update();
+        const auto render_start = std::chrono::steady_clock::now();
+        renderer.render(solver.acquireSnapshot(), solver.getBoundary());
+        const auto write_start = std::chrono::steady_clock::now();
+        if (write_frames && !writer.write(renderer.getPixels(), renderer.getWidth(), renderer.getHeight())){
+            std::cerr << "Failed to write frame " << frame << std::endl;
+            return 1;
+        }
+        const auto frame_end = std::chrono::steady_clock::now();
+
+        sim_seconds += std::chrono::duration<double>(render_start - sim_start).count();
+        render_seconds += std::chrono::duration<double>(write_start - render_start).count();
+        write_seconds += std::chrono::duration<double>(frame_end - write_start).count();
+    }
+
+    const double frames = std::max(1, config.frames);
+    std::cerr << std::fixed << std::setprecision(3)
+              << "particles: " << spawned << " | " << config.width << "x" << config.height << " | threads: " << threads << std::endl
+              << "ms/frame  sim: " << 1e3 * sim_seconds / frames << "  render: " << 1e3 * render_seconds / frames
+              << "  write: " << 1e3 * write_seconds / frames << std::endl
+              << "render fps: " << std::setprecision(1) << frames / render_seconds << std::endl;
+    return 0;
+}
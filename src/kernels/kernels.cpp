@@ -0,0 +1,458 @@
+#define GLM_ENABLE_EXPERIMENTAL
+
+#include <cmath>
+#include <glm/glm.hpp>
+
+#include "../particleStore/particleStore.hpp"
+#include "../boundaries/boundaries.hpp"
+
+#include "kernels.hpp"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define KERNELS_X86 1
+#include <immintrin.h>
+#else
+#define KERNELS_X86 0
+#endif
+
+#if defined(__GNUC__)
+#define AVX2_TARGET __attribute__((target("avx2")))
+#else
+#define AVX2_TARGET
+#endif
+
+namespace {
+    struct RectParams {
+        float top_line;
+        float bottom_line;
+        float left_side;
+        float right_side;
+        float bounce;
+    };
+
+    struct CircleParams {
+        float center_x;
+        float center_y;
+        float radius;
+        float bounce;
+    };
+
+    // ---- scalar reference kernels; the SIMD versions finish their tails with these ----
+
+    void integrateScalar(ParticleStore& objects, float dt, size_t start, size_t end) {
+        float* __restrict xs = objects.x.data();
+        float* __restrict ys = objects.y.data();
+        float* __restrict last_xs = objects.last_x.data();
+        float* __restrict last_ys = objects.last_y.data();
+        float* __restrict acc_x = objects.acc_x.data();
+        float* __restrict acc_y = objects.acc_y.data();
+        const float dt2 = dt * dt;
+
+        for (size_t i = start; i < end; ++i) {
+            const float x = xs[i];
+            const float y = ys[i];
+            xs[i] = x + (x - last_xs[i]) + acc_x[i] * dt2;
+            ys[i] = y + (y - last_ys[i]) + acc_y[i] * dt2;
+            last_xs[i] = x;
+            last_ys[i] = y;
+            acc_x[i] = 0.0f;
+            acc_y[i] = 0.0f;
+        }
+    }
+
+    void constrainRectScalar(ParticleStore& objects, const RectParams& p, size_t start, size_t end) {
+        float* __restrict xs = objects.x.data();
+        float* __restrict ys = objects.y.data();
+        float* __restrict last_xs = objects.last_x.data();
+        float* __restrict last_ys = objects.last_y.data();
+        const float* __restrict radii = objects.radius.data();
+
+        for (size_t i = start; i < end; ++i) {
+            const float r = radii[i];
+            float x = xs[i];
+            float y = ys[i];
+            float vx = x - last_xs[i];
+            float vy = y - last_ys[i];
+            bool hit = false;
+
+            if (y - r <= p.top_line){
+                y = p.top_line + r;
+                vy *= -p.bounce;
+                hit = true;
+            }
+            if (y + r > p.bottom_line){
+                y = p.bottom_line - r;
+                vy *= -p.bounce;
+                hit = true;
+            }
+            if (x - r < p.left_side){
+                x = p.left_side + r;
+                vx *= -p.bounce;
+                hit = true;
+            }
+            if (x + r > p.right_side){
+                x = p.right_side - r;
+                vx *= -p.bounce;
+                hit = true;
+            }
+
+            if (hit){
+                xs[i] = x;
+                ys[i] = y;
+                last_xs[i] = x - vx;
+                last_ys[i] = y - vy;
+            }
+        }
+    }
+
+    void constrainCircleScalar(ParticleStore& objects, const CircleParams& p, size_t start, size_t end) {
+        float* __restrict xs = objects.x.data();
+        float* __restrict ys = objects.y.data();
+        float* __restrict last_xs = objects.last_x.data();
+        float* __restrict last_ys = objects.last_y.data();
+        const float* __restrict radii = objects.radius.data();
+
+        for (size_t i = start; i < end; ++i) {
+            const float r = radii[i];
+            const float dx = xs[i] - p.center_x;
+            const float dy = ys[i] - p.center_y;
+            const float dist_from_center = std::sqrt(dx * dx + dy * dy);
+
+            if (dist_from_center > p.radius - r) {
+                const float nx = dx / dist_from_center;
+                const float ny = dy / dist_from_center;
+                float vx = xs[i] - last_xs[i];
+                float vy = ys[i] - last_ys[i];
+
+                const float velocity_normal = vx * nx + vy * ny;
+                if (velocity_normal > 0) {
+                    vx -= (1.0f + p.bounce) * velocity_normal * nx;
+                    vy -= (1.0f + p.bounce) * velocity_normal * ny;
+                }
+
+                xs[i] = p.center_x + nx * (p.radius - r);
+                ys[i] = p.center_y + ny * (p.radius - r);
+                last_xs[i] = xs[i] - vx;
+                last_ys[i] = ys[i] - vy;
+            }
+        }
+    }
+
+#if KERNELS_X86
+    // ---- SSE2: two 4-wide blocks per iteration ----
+
+    inline __m128 selectSSE(__m128 mask, __m128 if_false, __m128 if_true) {
+        return _mm_or_ps(_mm_and_ps(mask, if_true), _mm_andnot_ps(mask, if_false));
+    }
+
+    inline void integrateBlockSSE(float* xs, float* last_xs, float* acc_x, __m128 dt2, size_t i) {
+        const __m128 x = _mm_loadu_ps(xs + i);
+        const __m128 last = _mm_loadu_ps(last_xs + i);
+        const __m128 acc = _mm_loadu_ps(acc_x + i);
+        _mm_storeu_ps(xs + i, _mm_add_ps(_mm_add_ps(x, _mm_sub_ps(x, last)), _mm_mul_ps(acc, dt2)));
+        _mm_storeu_ps(last_xs + i, x);
+        _mm_storeu_ps(acc_x + i, _mm_setzero_ps());
+    }
+
+    void integrateSSE(ParticleStore& objects, float dt, size_t start, size_t end) {
+        float* xs = objects.x.data();
+        float* ys = objects.y.data();
+        float* last_xs = objects.last_x.data();
+        float* last_ys = objects.last_y.data();
+        float* acc_x = objects.acc_x.data();
+        float* acc_y = objects.acc_y.data();
+        const __m128 dt2 = _mm_set1_ps(dt * dt);
+
+        size_t i = start;
+        for (; i + 8 <= end; i += 8) {
+            integrateBlockSSE(xs, last_xs, acc_x, dt2, i);
+            integrateBlockSSE(xs, last_xs, acc_x, dt2, i + 4);
+            integrateBlockSSE(ys, last_ys, acc_y, dt2, i);
+            integrateBlockSSE(ys, last_ys, acc_y, dt2, i + 4);
+        }
+        integrateScalar(objects, dt, i, end);
+    }
+
+    inline void constrainRectBlockSSE(ParticleStore& objects, const RectParams& p, size_t i) {
+        const __m128 r = _mm_loadu_ps(objects.radius.data() + i);
+        __m128 x = _mm_loadu_ps(objects.x.data() + i);
+        __m128 y = _mm_loadu_ps(objects.y.data() + i);
+        __m128 vx = _mm_sub_ps(x, _mm_loadu_ps(objects.last_x.data() + i));
+        __m128 vy = _mm_sub_ps(y, _mm_loadu_ps(objects.last_y.data() + i));
+        const __m128 neg_bounce = _mm_set1_ps(-p.bounce);
+
+        // same order as the scalar kernel: each test sees the result of the previous one
+        const __m128 top = _mm_set1_ps(p.top_line);
+        const __m128 hit_top = _mm_cmple_ps(_mm_sub_ps(y, r), top);
+        y = selectSSE(hit_top, y, _mm_add_ps(top, r));
+        vy = selectSSE(hit_top, vy, _mm_mul_ps(vy, neg_bounce));
+
+        const __m128 bottom = _mm_set1_ps(p.bottom_line);
+        const __m128 hit_bottom = _mm_cmpgt_ps(_mm_add_ps(y, r), bottom);
+        y = selectSSE(hit_bottom, y, _mm_sub_ps(bottom, r));
+        vy = selectSSE(hit_bottom, vy, _mm_mul_ps(vy, neg_bounce));
+
+        const __m128 left = _mm_set1_ps(p.left_side);
+        const __m128 hit_left = _mm_cmplt_ps(_mm_sub_ps(x, r), left);
+        x = selectSSE(hit_left, x, _mm_add_ps(left, r));
+        vx = selectSSE(hit_left, vx, _mm_mul_ps(vx, neg_bounce));
+
+        const __m128 right = _mm_set1_ps(p.right_side);
+        const __m128 hit_right = _mm_cmpgt_ps(_mm_add_ps(x, r), right);
+        x = selectSSE(hit_right, x, _mm_sub_ps(right, r));
+        vx = selectSSE(hit_right, vx, _mm_mul_ps(vx, neg_bounce));
+
+        const __m128 hit = _mm_or_ps(_mm_or_ps(hit_top, hit_bottom), _mm_or_ps(hit_left, hit_right));
+        if (_mm_movemask_ps(hit) == 0) {
+            return;
+        }
+        _mm_storeu_ps(objects.x.data() + i, x);
+        _mm_storeu_ps(objects.y.data() + i, y);
+        _mm_storeu_ps(objects.last_x.data() + i, selectSSE(hit, _mm_loadu_ps(objects.last_x.data() + i), _mm_sub_ps(x, vx)));
+        _mm_storeu_ps(objects.last_y.data() + i, selectSSE(hit, _mm_loadu_ps(objects.last_y.data() + i), _mm_sub_ps(y, vy)));
+    }
+
+    void constrainRectSSE(ParticleStore& objects, const RectParams& p, size_t start, size_t end) {
+        size_t i = start;
+        for (; i + 8 <= end; i += 8) {
+            constrainRectBlockSSE(objects, p, i);
+            constrainRectBlockSSE(objects, p, i + 4);
+        }
+        constrainRectScalar(objects, p, i, end);
+    }
+
+    inline void constrainCircleBlockSSE(ParticleStore& objects, const CircleParams& p, size_t i) {
+        const __m128 r = _mm_loadu_ps(objects.radius.data() + i);
+        const __m128 x = _mm_loadu_ps(objects.x.data() + i);
+        const __m128 y = _mm_loadu_ps(objects.y.data() + i);
+        const __m128 cx = _mm_set1_ps(p.center_x);
+        const __m128 cy = _mm_set1_ps(p.center_y);
+        const __m128 dx = _mm_sub_ps(x, cx);
+        const __m128 dy = _mm_sub_ps(y, cy);
+        const __m128 dist = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)));
+        const __m128 limit = _mm_sub_ps(_mm_set1_ps(p.radius), r);
+
+        const __m128 outside = _mm_cmpgt_ps(dist, limit);
+        if (_mm_movemask_ps(outside) == 0) {
+            return;
+        }
+
+        const __m128 nx = _mm_div_ps(dx, dist);
+        const __m128 ny = _mm_div_ps(dy, dist);
+        const __m128 last_x = _mm_loadu_ps(objects.last_x.data() + i);
+        const __m128 last_y = _mm_loadu_ps(objects.last_y.data() + i);
+        __m128 vx = _mm_sub_ps(x, last_x);
+        __m128 vy = _mm_sub_ps(y, last_y);
+
+        const __m128 velocity_normal = _mm_add_ps(_mm_mul_ps(vx, nx), _mm_mul_ps(vy, ny));
+        const __m128 moving_out = _mm_cmpgt_ps(velocity_normal, _mm_setzero_ps());
+        const __m128 impulse = _mm_mul_ps(_mm_set1_ps(1.0f + p.bounce), velocity_normal);
+        vx = selectSSE(moving_out, vx, _mm_sub_ps(vx, _mm_mul_ps(impulse, nx)));
+        vy = selectSSE(moving_out, vy, _mm_sub_ps(vy, _mm_mul_ps(impulse, ny)));
+
+        const __m128 new_x = _mm_add_ps(cx, _mm_mul_ps(nx, limit));
+        const __m128 new_y = _mm_add_ps(cy, _mm_mul_ps(ny, limit));
+        _mm_storeu_ps(objects.x.data() + i, selectSSE(outside, x, new_x));
+        _mm_storeu_ps(objects.y.data() + i, selectSSE(outside, y, new_y));
+        _mm_storeu_ps(objects.last_x.data() + i, selectSSE(outside, last_x, _mm_sub_ps(new_x, vx)));
+        _mm_storeu_ps(objects.last_y.data() + i, selectSSE(outside, last_y, _mm_sub_ps(new_y, vy)));
+    }
+
+    void constrainCircleSSE(ParticleStore& objects, const CircleParams& p, size_t start, size_t end) {
+        size_t i = start;
+        for (; i + 8 <= end; i += 8) {
+            constrainCircleBlockSSE(objects, p, i);
+            constrainCircleBlockSSE(objects, p, i + 4);
+        }
+        constrainCircleScalar(objects, p, i, end);
+    }
+
+    // ---- AVX2: one 8-wide block per iteration ----
+
+    AVX2_TARGET inline __m256 selectAVX(__m256 mask, __m256 if_false, __m256 if_true) {
+        return _mm256_blendv_ps(if_false, if_true, mask);
+    }
+
+    AVX2_TARGET void integrateAVX2(ParticleStore& objects, float dt, size_t start, size_t end) {
+        float* xs = objects.x.data();
+        float* ys = objects.y.data();
+        float* last_xs = objects.last_x.data();
+        float* last_ys = objects.last_y.data();
+        float* acc_x = objects.acc_x.data();
+        float* acc_y = objects.acc_y.data();
+        const __m256 dt2 = _mm256_set1_ps(dt * dt);
+        const __m256 zero = _mm256_setzero_ps();
+
+        size_t i = start;
+        for (; i + 8 <= end; i += 8) {
+            const __m256 x = _mm256_loadu_ps(xs + i);
+            const __m256 y = _mm256_loadu_ps(ys + i);
+            const __m256 new_x = _mm256_add_ps(_mm256_add_ps(x, _mm256_sub_ps(x, _mm256_loadu_ps(last_xs + i))), _mm256_mul_ps(_mm256_loadu_ps(acc_x + i), dt2));
+            const __m256 new_y = _mm256_add_ps(_mm256_add_ps(y, _mm256_sub_ps(y, _mm256_loadu_ps(last_ys + i))), _mm256_mul_ps(_mm256_loadu_ps(acc_y + i), dt2));
+            _mm256_storeu_ps(xs + i, new_x);
+            _mm256_storeu_ps(ys + i, new_y);
+            _mm256_storeu_ps(last_xs + i, x);
+            _mm256_storeu_ps(last_ys + i, y);
+            _mm256_storeu_ps(acc_x + i, zero);
+            _mm256_storeu_ps(acc_y + i, zero);
+        }
+        integrateScalar(objects, dt, i, end);
+    }
+
+    AVX2_TARGET void constrainRectAVX2(ParticleStore& objects, const RectParams& p, size_t start, size_t end) {
+        const __m256 neg_bounce = _mm256_set1_ps(-p.bounce);
+        const __m256 top = _mm256_set1_ps(p.top_line);
+        const __m256 bottom = _mm256_set1_ps(p.bottom_line);
+        const __m256 left = _mm256_set1_ps(p.left_side);
+        const __m256 right = _mm256_set1_ps(p.right_side);
+
+        size_t i = start;
+        for (; i + 8 <= end; i += 8) {
+            const __m256 r = _mm256_loadu_ps(objects.radius.data() + i);
+            __m256 x = _mm256_loadu_ps(objects.x.data() + i);
+            __m256 y = _mm256_loadu_ps(objects.y.data() + i);
+            const __m256 last_x = _mm256_loadu_ps(objects.last_x.data() + i);
+            const __m256 last_y = _mm256_loadu_ps(objects.last_y.data() + i);
+            __m256 vx = _mm256_sub_ps(x, last_x);
+            __m256 vy = _mm256_sub_ps(y, last_y);
+
+            const __m256 hit_top = _mm256_cmp_ps(_mm256_sub_ps(y, r), top, _CMP_LE_OQ);
+            y = selectAVX(hit_top, y, _mm256_add_ps(top, r));
+            vy = selectAVX(hit_top, vy, _mm256_mul_ps(vy, neg_bounce));
+
+            const __m256 hit_bottom = _mm256_cmp_ps(_mm256_add_ps(y, r), bottom, _CMP_GT_OQ);
+            y = selectAVX(hit_bottom, y, _mm256_sub_ps(bottom, r));
+            vy = selectAVX(hit_bottom, vy, _mm256_mul_ps(vy, neg_bounce));
+
+            const __m256 hit_left = _mm256_cmp_ps(_mm256_sub_ps(x, r), left, _CMP_LT_OQ);
+            x = selectAVX(hit_left, x, _mm256_add_ps(left, r));
+            vx = selectAVX(hit_left, vx, _mm256_mul_ps(vx, neg_bounce));
+
+            const __m256 hit_right = _mm256_cmp_ps(_mm256_add_ps(x, r), right, _CMP_GT_OQ);
+            x = selectAVX(hit_right, x, _mm256_sub_ps(right, r));
+            vx = selectAVX(hit_right, vx, _mm256_mul_ps(vx, neg_bounce));
+
+            const __m256 hit = _mm256_or_ps(_mm256_or_ps(hit_top, hit_bottom), _mm256_or_ps(hit_left, hit_right));
+            if (_mm256_movemask_ps(hit) == 0) {
+                continue;
+            }
+            _mm256_storeu_ps(objects.x.data() + i, x);
+            _mm256_storeu_ps(objects.y.data() + i, y);
+            _mm256_storeu_ps(objects.last_x.data() + i, selectAVX(hit, last_x, _mm256_sub_ps(x, vx)));
+            _mm256_storeu_ps(objects.last_y.data() + i, selectAVX(hit, last_y, _mm256_sub_ps(y, vy)));
+        }
+        constrainRectScalar(objects, p, i, end);
+    }
+
+    AVX2_TARGET void constrainCircleAVX2(ParticleStore& objects, const CircleParams& p, size_t start, size_t end) {
+        const __m256 cx = _mm256_set1_ps(p.center_x);
+        const __m256 cy = _mm256_set1_ps(p.center_y);
+        const __m256 boundary_radius = _mm256_set1_ps(p.radius);
+        const __m256 restitution = _mm256_set1_ps(1.0f + p.bounce);
+        const __m256 zero = _mm256_setzero_ps();
+
+        size_t i = start;
+        for (; i + 8 <= end; i += 8) {
+            const __m256 r = _mm256_loadu_ps(objects.radius.data() + i);
+            const __m256 x = _mm256_loadu_ps(objects.x.data() + i);
+            const __m256 y = _mm256_loadu_ps(objects.y.data() + i);
+            const __m256 dx = _mm256_sub_ps(x, cx);
+            const __m256 dy = _mm256_sub_ps(y, cy);
+            const __m256 dist = _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)));
+            const __m256 limit = _mm256_sub_ps(boundary_radius, r);
+
+            const __m256 outside = _mm256_cmp_ps(dist, limit, _CMP_GT_OQ);
+            if (_mm256_movemask_ps(outside) == 0) {
+                continue;
+            }
+
+            const __m256 nx = _mm256_div_ps(dx, dist);
+            const __m256 ny = _mm256_div_ps(dy, dist);
+            const __m256 last_x = _mm256_loadu_ps(objects.last_x.data() + i);
+            const __m256 last_y = _mm256_loadu_ps(objects.last_y.data() + i);
+            __m256 vx = _mm256_sub_ps(x, last_x);
+            __m256 vy = _mm256_sub_ps(y, last_y);
+
+            const __m256 velocity_normal = _mm256_add_ps(_mm256_mul_ps(vx, nx), _mm256_mul_ps(vy, ny));
+            const __m256 moving_out = _mm256_cmp_ps(velocity_normal, zero, _CMP_GT_OQ);
+            const __m256 impulse = _mm256_mul_ps(restitution, velocity_normal);
+            vx = selectAVX(moving_out, vx, _mm256_sub_ps(vx, _mm256_mul_ps(impulse, nx)));
+            vy = selectAVX(moving_out, vy, _mm256_sub_ps(vy, _mm256_mul_ps(impulse, ny)));
+
+            const __m256 new_x = _mm256_add_ps(cx, _mm256_mul_ps(nx, limit));
+            const __m256 new_y = _mm256_add_ps(cy, _mm256_mul_ps(ny, limit));
+            _mm256_storeu_ps(objects.x.data() + i, selectAVX(outside, x, new_x));
+            _mm256_storeu_ps(objects.y.data() + i, selectAVX(outside, y, new_y));
+            _mm256_storeu_ps(objects.last_x.data() + i, selectAVX(outside, last_x, _mm256_sub_ps(new_x, vx)));
+            _mm256_storeu_ps(objects.last_y.data() + i, selectAVX(outside, last_y, _mm256_sub_ps(new_y, vy)));
+        }
+        constrainCircleScalar(objects, p, i, end);
+    }
+#endif
+}
+
+SimdLevel detectSimdLevel() {
+#if KERNELS_X86 && defined(__GNUC__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return SimdLevel::AVX2;
+    }
+    return SimdLevel::SSE;
+#elif KERNELS_X86
+    return SimdLevel::SSE; // SSE2 is part of the x86-64 baseline
+#else
+    return SimdLevel::Scalar;
+#endif
+}
+
+const char* getSimdLevelName(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::AVX2: return "avx2";
+        case SimdLevel::SSE: return "sse";
+        default: return "scalar";
+    }
+}
+
+void integrateKernel(SimdLevel level, ParticleStore& objects, float dt, size_t start, size_t end) {
+#if KERNELS_X86
+    if (level == SimdLevel::AVX2) {
+        integrateAVX2(objects, dt, start, end);
+        return;
+    }
+    if (level == SimdLevel::SSE) {
+        integrateSSE(objects, dt, start, end);
+        return;
+    }
+#endif
+    integrateScalar(objects, dt, start, end);
+}
+
+void constrainRectKernel(SimdLevel level, ParticleStore& objects, const RectBoundingArea& boundary, float bounce_coefficient, size_t start, size_t end) {
+    const RectParams params = {boundary.top_line, boundary.bottom_line, boundary.left_side, boundary.right_side, bounce_coefficient};
+#if KERNELS_X86
+    if (level == SimdLevel::AVX2) {
+        constrainRectAVX2(objects, params, start, end);
+        return;
+    }
+    if (level == SimdLevel::SSE) {
+        constrainRectSSE(objects, params, start, end);
+        return;
+    }
+#endif
+    constrainRectScalar(objects, params, start, end);
+}
+
+void constrainCircleKernel(SimdLevel level, ParticleStore& objects, const CircleBoundingArea& boundary, float bounce_coefficient, size_t start, size_t end) {
+    const CircleParams params = {boundary.center.x, boundary.center.y, boundary.radius, bounce_coefficient};
+#if KERNELS_X86
+    if (level == SimdLevel::AVX2) {
+        constrainCircleAVX2(objects, params, start, end);
+        return;
+    }
+    if (level == SimdLevel::SSE) {
+        constrainCircleSSE(objects, params, start, end);
+        return;
+    }
+#endif
+    constrainCircleScalar(objects, params, start, end);
+}
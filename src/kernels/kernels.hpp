@@ -0,0 +1,28 @@
+#define GLM_ENABLE_EXPERIMENTAL
+#ifndef KERNELS_HPP
+#define KERNELS_HPP
+
+#include "../particleStore/particleStore.hpp"
+#include "../boundaries/boundaries.hpp"
+
+// Batch kernels for the per-particle solver passes. The SSE and AVX2 versions
+// process 8 particles per loop iteration and use only correctly rounded
+// operations (no FMA) in the same order as the scalar code, so they are
+// expected to match the scalar kernels bit for bit. kernel_bench treats any
+// difference above KERNEL_TOLERANCE_ULPS as a failure.
+enum class SimdLevel {
+    Scalar,
+    SSE,
+    AVX2
+};
+
+const int KERNEL_TOLERANCE_ULPS = 1;
+
+SimdLevel detectSimdLevel();
+const char* getSimdLevelName(SimdLevel level);
+
+void integrateKernel(SimdLevel level, ParticleStore& objects, float dt, size_t start, size_t end);
+void constrainRectKernel(SimdLevel level, ParticleStore& objects, const RectBoundingArea& boundary, float bounce_coefficient, size_t start, size_t end);
+void constrainCircleKernel(SimdLevel level, ParticleStore& objects, const CircleBoundingArea& boundary, float bounce_coefficient, size_t start, size_t end);
+
+#endif
@@ -0,0 +1,104 @@
+#define GLM_ENABLE_EXPERIMENTAL
+
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include <glm/glm.hpp>
+
+#include "../particleStore/particleStore.hpp"
+
+#include "mortonOrder.hpp"
+
+namespace {
+    const float MAX_CELL_COORDINATE = 65535.0f;
+    const int RADIX_BITS = 8;
+    const size_t RADIX_BUCKETS = 1 << RADIX_BITS;
+    const int DISORDER_BLOCK_BITS = 6; // Morton keys of 8x8 cells share all but the low 6 bits
+
+    uint32_t spreadBits(uint32_t v) {
+        v &= 0xffff;
+        v = (v | (v << 8)) & 0x00ff00ff;
+        v = (v | (v << 4)) & 0x0f0f0f0f;
+        v = (v | (v << 2)) & 0x33333333;
+        v = (v | (v << 1)) & 0x55555555;
+        return v;
+    }
+
+    uint32_t getCellCoordinate(float position, float origin, float inv_cell_size) {
+        // clamp before the cast so far away or NaN positions still get a key
+        const float cell = std::floor((position - origin) * inv_cell_size);
+        return static_cast<uint32_t>(std::fmin(std::fmax(cell, 0.0f), MAX_CELL_COORDINATE));
+    }
+}
+
+uint32_t getMortonKey(uint32_t x, uint32_t y) {
+    return spreadBits(x) | (spreadBits(y) << 1);
+}
+
+void MortonOrder::reserve(size_t num_objects) {
+    keys.reserve(num_objects);
+    entries.reserve(num_objects);
+    scratch.reserve(num_objects);
+    order.reserve(num_objects);
+}
+
+void MortonOrder::computeKeys(const ParticleStore& objects, glm::vec2 min_corner, float cell_size) {
+    const size_t num_objects = objects.size();
+    const float inv_cell_size = 1.0f / cell_size;
+    const float* xs = objects.x.data();
+    const float* ys = objects.y.data();
+    keys.resize(num_objects);
+    for (size_t i = 0; i < num_objects; ++i) {
+        keys[i] = getMortonKey(getCellCoordinate(xs[i], min_corner.x, inv_cell_size),
+                               getCellCoordinate(ys[i], min_corner.y, inv_cell_size));
+    }
+}
+
+float MortonOrder::measureDisorder() const {
+    if (keys.size() < 2) {
+        return 0.0f;
+    }
+    size_t descents = 0;
+    for (size_t i = 1; i < keys.size(); ++i) {
+        descents += (keys[i] >> DISORDER_BLOCK_BITS) < (keys[i - 1] >> DISORDER_BLOCK_BITS);
+    }
+    return static_cast<float>(descents) / (keys.size() - 1);
+}
+
+const std::vector<uint32_t>& MortonOrder::sort() {
+    const size_t num_objects = keys.size();
+    entries.resize(num_objects);
+    scratch.resize(num_objects);
+    for (size_t i = 0; i < num_objects; ++i) {
+        entries[i] = (static_cast<uint64_t>(keys[i]) << 32) | i;
+    }
+
+    // LSD radix sort over the key bytes; a byte every key shares is skipped
+    size_t counts[RADIX_BUCKETS];
+    for (int shift = 32; shift < 64; shift += RADIX_BITS) {
+        std::fill(counts, counts + RADIX_BUCKETS, 0);
+        for (uint64_t entry : entries) {
+            ++counts[(entry >> shift) & (RADIX_BUCKETS - 1)];
+        }
+        if (num_objects == 0 || counts[(entries[0] >> shift) & (RADIX_BUCKETS - 1)] == num_objects) {
+            continue;
+        }
+        size_t offset = 0;
+        for (size_t& count : counts) {
+            const size_t bucket = count;
+            count = offset;
+            offset += bucket;
+        }
+        for (uint64_t entry : entries) {
+            scratch[counts[(entry >> shift) & (RADIX_BUCKETS - 1)]++] = entry;
+        }
+        entries.swap(scratch);
+    }
+
+    order.resize(num_objects);
+    for (size_t i = 0; i < num_objects; ++i) {
+        order[i] = static_cast<uint32_t>(entries[i]);
+    }
+    return order;
+}
@@ -0,0 +1,37 @@
+#define GLM_ENABLE_EXPERIMENTAL
+#ifndef MORTON_ORDER_HPP
+#define MORTON_ORDER_HPP
+
+#include <vector>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+#include "../particleStore/particleStore.hpp"
+
+// interleaves the low 16 bits of x and y, x in the even bits
+uint32_t getMortonKey(uint32_t x, uint32_t y);
+
+// Z-order of the particles' cells. Sorting the particle arrays by it keeps particles
+// that are close in space close in memory, so the cells a collision pass visits
+// together share cache lines instead of being scattered in spawn order.
+class MortonOrder {
+    public:
+        void reserve(size_t num_objects);
+
+        // key of the cell every particle sits in, for cells of cell_size from min_corner
+        void computeKeys(const ParticleStore& objects, glm::vec2 min_corner, float cell_size);
+        // share of particles whose 8x8 cell block comes before the block of the particle
+        // before them in memory: 0 once sorted, about 0.5 for a random order. Particles
+        // jostling between neighbouring cells mostly stay inside their block.
+        float measureDisorder() const;
+        // permutation that sorts the keys, stable so ties keep their current order
+        const std::vector<uint32_t>& sort();
+
+    private:
+        std::vector<uint32_t> keys;
+        std::vector<uint64_t> entries; // key in the high half, index in the low half
+        std::vector<uint64_t> scratch;
+        std::vector<uint32_t> order;
+};
+
+#endif
@@ -0,0 +1,214 @@
+#define GLM_ENABLE_EXPERIMENTAL
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <cmath>
+#include <glm/glm.hpp>
+
+#include "../particleStore/particleStore.hpp"
+#include "../boundaries/boundaries.hpp"
+
+#include "obstacles.hpp"
+
+namespace {
+    const float PI = 3.14159265359f;
+}
+
+ObstacleField::ObstacleField()
+: origin(0.0f)
+, spacing(1.0f)
+, inv_spacing(1.0f)
+, columns(0)
+, rows(0) {}
+
+void ObstacleField::addPolygon(std::vector<glm::vec2> points) {
+    if (points.size() < 3) {
+        return;
+    }
+    polygons.push_back(PolygonBoundingArea::create(std::move(points)));
+}
+
+void ObstacleField::bake(float spacing_, float margin) {
+    distances.clear();
+    columns = 0;
+    rows = 0;
+    if (polygons.empty() || spacing_ <= 0.0f) {
+        return;
+    }
+
+    glm::vec2 min_corner, max_corner;
+    getBounds(min_corner, max_corner);
+    spacing = spacing_;
+    inv_spacing = 1.0f / spacing;
+    origin = min_corner - glm::vec2(margin);
+    columns = static_cast<int>(std::ceil((max_corner.x - min_corner.x + 2.0f * margin) * inv_spacing)) + 1;
+    rows = static_cast<int>(std::ceil((max_corner.y - min_corner.y + 2.0f * margin) * inv_spacing)) + 1;
+
+    // exact distance to the nearest edge at every node; this is the only place
+    // that walks the edges
+    distances.resize(static_cast<size_t>(columns) * rows);
+    for (int j = 0; j < rows; ++j) {
+        for (int i = 0; i < columns; ++i) {
+            const glm::vec2 p = origin + glm::vec2(i, j) * spacing;
+            float distance = INFINITY;
+            for (const PolygonBoundingArea& polygon : polygons) {
+                // a polygon's clearance is positive inside it, the field is positive outside
+                distance = std::min(distance, -polygon.getClearance(p));
+            }
+            distances[static_cast<size_t>(j) * columns + i] = distance;
+        }
+    }
+}
+
+bool ObstacleField::empty() const {
+    return distances.empty();
+}
+
+bool ObstacleField::sample(glm::vec2 p, float& distance, glm::vec2& normal) const {
+    const float gx = (p.x - origin.x) * inv_spacing;
+    const float gy = (p.y - origin.y) * inv_spacing;
+    if (!(gx >= 0.0f && gy >= 0.0f && gx <= columns - 1 && gy <= rows - 1)) {
+        return false;
+    }
+    const int i = std::min(static_cast<int>(gx), columns - 2);
+    const int j = std::min(static_cast<int>(gy), rows - 2);
+    const float fx = gx - i;
+    const float fy = gy - j;
+
+    const float* row0 = distances.data() + static_cast<size_t>(j) * columns + i;
+    const float* row1 = row0 + columns;
+    const float d00 = row0[0], d10 = row0[1];
+    const float d01 = row1[0], d11 = row1[1];
+
+    distance = (d00 * (1.0f - fx) + d10 * fx) * (1.0f - fy) + (d01 * (1.0f - fx) + d11 * fx) * fy;
+    // gradient of the bilinear patch
+    const glm::vec2 gradient = glm::vec2(
+        (d10 - d00) * (1.0f - fy) + (d11 - d01) * fy,
+        (d01 - d00) * (1.0f - fx) + (d11 - d10) * fx
+    );
+    const float length = glm::length(gradient);
+    // flat spots only occur on an obstacle's medial axis; any direction resolves them
+    normal = length > 0.0f ? gradient / length : glm::vec2(0.0f, 1.0f);
+    return true;
+}
+
+glm::vec2 ObstacleField::constrain(ParticleStore& objects, float bounce_coefficient, size_t start, size_t end) const {
+    glm::vec2 momentum = glm::vec2(0.0f);
+    if (empty()) {
+        return momentum;
+    }
+    float* xs = objects.x.data();
+    float* ys = objects.y.data();
+    float* last_xs = objects.last_x.data();
+    float* last_ys = objects.last_y.data();
+    const float* radii = objects.radius.data();
+    const float* masses = objects.mass.data();
+
+    for (size_t i = start; i < end; ++i) {
+        const float r = radii[i];
+        float distance;
+        glm::vec2 n;
+        if (!sample(glm::vec2(xs[i], ys[i]), distance, n) || distance >= r) {
+            continue;
+        }
+        float vx = xs[i] - last_xs[i];
+        float vy = ys[i] - last_ys[i];
+        const float velocity_normal = vx * n.x + vy * n.y;
+        if (velocity_normal < 0) {
+            const float change = -(1.0f + bounce_coefficient) * velocity_normal;
+            vx += change * n.x;
+            vy += change * n.y;
+            momentum += masses[i] * change * n;
+        }
+        xs[i] += n.x * (r - distance);
+        ys[i] += n.y * (r - distance);
+        last_xs[i] = xs[i] - vx;
+        last_ys[i] = ys[i] - vy;
+    }
+    return momentum;
+}
+
+void ObstacleField::getBounds(glm::vec2& min_corner, glm::vec2& max_corner) const {
+    min_corner = glm::vec2(INFINITY);
+    max_corner = glm::vec2(-INFINITY);
+    for (const PolygonBoundingArea& polygon : polygons) {
+        glm::vec2 polygon_min, polygon_max;
+        polygon.getBounds(polygon_min, polygon_max);
+        min_corner = glm::min(min_corner, polygon_min);
+        max_corner = glm::max(max_corner, polygon_max);
+    }
+}
+
+void ObstacleField::getSpans(float y, std::vector<glm::vec2>& spans) const {
+    for (const PolygonBoundingArea& polygon : polygons) {
+        polygon.getSpans(y, spans);
+    }
+}
+
+std::vector<glm::vec2> loadPointList(const std::string& path) {
+    std::vector<glm::vec2> points;
+    std::ifstream file(path);
+    std::string line;
+    while (std::getline(file, line)) {
+        std::replace(line.begin(), line.end(), ',', ' ');
+        std::istringstream fields(line);
+        glm::vec2 p;
+        if (fields >> p.x >> p.y) {
+            points.push_back(p);
+        }
+    }
+    // the closing point is implied
+    if (points.size() > 1 && points.front() == points.back()) {
+        points.pop_back();
+    }
+    return points;
+}
+
+std::vector<glm::vec2> makeNacaProfile(const std::string& digits, float chord, int points_per_side) {
+    if (digits.size() != 4 || !std::all_of(digits.begin(), digits.end(), [](char c) { return c >= '0' && c <= '9'; }) || points_per_side < 2) {
+        return {};
+    }
+    const float m = (digits[0] - '0') / 100.0f;
+    const float p = (digits[1] - '0') / 10.0f;
+    const float t = std::stoi(digits.substr(2)) / 100.0f;
+
+    std::vector<glm::vec2> upper, lower;
+    for (int k = 0; k < points_per_side; ++k) {
+        // cosine spacing clusters points at both edges, where curvature is highest
+        const float x = 0.5f * (1.0f - std::cos(PI * k / (points_per_side - 1)));
+        const float thickness = 5.0f * t * (0.2969f * std::sqrt(x) - 0.1260f * x - 0.3516f * x * x
+                                           + 0.2843f * x * x * x - 0.1036f * x * x * x * x);
+        float camber = 0.0f;
+        float slope = 0.0f;
+        if (m > 0.0f && p > 0.0f) {
+            if (x < p) {
+                camber = m / (p * p) * (2.0f * p * x - x * x);
+                slope = 2.0f * m / (p * p) * (p - x);
+            }
+            else {
+                camber = m / ((1.0f - p) * (1.0f - p)) * (1.0f - 2.0f * p + 2.0f * p * x - x * x);
+                slope = 2.0f * m / ((1.0f - p) * (1.0f - p)) * (p - x);
+            }
+        }
+        const float theta = std::atan(slope);
+        upper.push_back(chord * glm::vec2(x - thickness * std::sin(theta), camber + thickness * std::cos(theta)));
+        lower.push_back(chord * glm::vec2(x + thickness * std::sin(theta), camber - thickness * std::cos(theta)));
+    }
+
+    // trailing edge -> upper surface -> leading edge -> lower surface; both surfaces
+    // share their first (leading edge) and last (trailing edge) points
+    std::vector<glm::vec2> points(upper.rbegin(), upper.rend());
+    points.insert(points.end(), lower.begin() + 1, lower.end() - 1);
+    return points;
+}
+
+void placePoints(std::vector<glm::vec2>& points, glm::vec2 offset, float angle) {
+    const float c = std::cos(angle);
+    const float s = std::sin(angle);
+    for (glm::vec2& p : points) {
+        p = glm::vec2(c * p.x - s * p.y, s * p.x + c * p.y) + offset;
+    }
+}
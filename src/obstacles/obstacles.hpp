@@ -0,0 +1,62 @@
+#define GLM_ENABLE_EXPERIMENTAL
+#ifndef OBSTACLES_HPP
+#define OBSTACLES_HPP
+
+#include <vector>
+#include <string>
+#include <glm/glm.hpp>
+
+#include "../particleStore/particleStore.hpp"
+#include "../boundaries/boundaries.hpp"
+
+// Static obstacles inside the domain. The polygons are baked once into a signed
+// distance field on a regular grid around them (negative inside an obstacle), so
+// resolving a particle is one bilinear lookup plus its gradient, whatever the
+// number of edges. Outside the baked grid particles are never in contact.
+class ObstacleField {
+    public:
+        ObstacleField();
+
+        // closed polygon, either winding; the last point connects back to the first.
+        // Fewer than 3 points enclose nothing and are ignored.
+        void addPolygon(std::vector<glm::vec2> points);
+        // samples the field every `spacing` units over the obstacles' bounds grown by
+        // margin; call after the last addPolygon. margin must cover the largest particle radius
+        void bake(float spacing, float margin);
+        bool empty() const;
+
+        // signed distance at p and the unit outward direction; false outside the baked grid
+        bool sample(glm::vec2 p, float& distance, glm::vec2& normal) const;
+        // pushes particles [start, end) out of the obstacles, reflecting their velocity.
+        // Returns the momentum the obstacles gave those particles, as mass times
+        // change in per-substep displacement.
+        glm::vec2 constrain(ParticleStore& objects, float bounce_coefficient, size_t start, size_t end) const;
+
+        void getBounds(glm::vec2& min_corner, glm::vec2& max_corner) const;
+        // x intervals covered by obstacles along the line y, for rendering
+        void getSpans(float y, std::vector<glm::vec2>& spans) const;
+
+    private:
+        std::vector<PolygonBoundingArea> polygons;
+
+        glm::vec2 origin;
+        float spacing;
+        float inv_spacing;
+        int columns;
+        int rows;
+        std::vector<float> distances; // row-major, rows * columns
+};
+
+// Reads one "x y" or "x, y" point per line (Selig .dat airfoil files work as is);
+// lines that do not start with two numbers are skipped
+std::vector<glm::vec2> loadPointList(const std::string& path);
+
+// NACA 4-digit section ("2412" etc.) with a closed trailing edge: leading edge at
+// the origin, chord along +x, points_per_side cosine-spaced points per surface.
+// Empty when the designation is not four digits.
+std::vector<glm::vec2> makeNacaProfile(const std::string& digits, float chord, int points_per_side);
+
+// rotates points by angle (radians, counter-clockwise) about the origin, then moves them by offset
+void placePoints(std::vector<glm::vec2>& points, glm::vec2 offset, float angle);
+
+#endif
@@ -1,7 +1,5 @@
 #define GLM_ENABLE_EXPERIMENTAL
 
-#include <GLFW/glfw3.h>
-#include <GL/GL.h>
 #include <glm/glm.hpp>
 
 #include "../constants/constants.hpp"
@@ -38,18 +36,3 @@ void Particle::addVelocity(glm::vec2 v, float dt){
 glm::vec2 Particle::getVelocity(){
     return position - position_last;
 }
-
-void Particle::draw(int num_segments) {
-    glColor3f(0.0f, 1.0f, 1.0f);
-    glBegin(GL_TRIANGLE_FAN);
-    glVertex2f(position.x, position.y);
-
-    for (int i = 0; i <= num_segments; ++i) {
-        float angle = 2.0f * 3.14159265359f * (float(i) / num_segments);
-        float x = position.x + cos(angle) * radius;
-        float y = position.y + sin(angle) * radius;
-        glVertex2f(x, y);
-    }
-
-    glEnd();
-} 
\ No newline at end of file
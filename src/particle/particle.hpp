@@ -24,8 +24,6 @@ class Particle {
         void addVelocity(glm::vec2 v, float dt);
 
         glm::vec2 getVelocity();
-
-        void draw(int num_segments);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,341 @@
+#define GLM_ENABLE_EXPERIMENTAL
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <functional>
+#include <glm/glm.hpp>
+
+#include "../particle/particle.hpp"
+
+#include "particleStore.hpp"
+
+// std::count binds it by reference, so unoptimised builds need the definition
+const uint32_t ParticleStore::ASLEEP;
+
+ParticleView::ParticleView(ParticleStore& store_, ParticleHandle handle_)
+: store(&store_)
+, handle(handle_)
+{}
+
+ParticleHandle ParticleView::getHandle() const {
+    return handle;
+}
+
+bool ParticleView::isValid() const {
+    return store->contains(handle);
+}
+
+size_t ParticleView::getIndex() const {
+    size_t index;
+    return findIndex(index) ? index : INVALID_INDEX;
+}
+
+bool ParticleView::findIndex(size_t& index) const {
+    // the slot of a removed particle may already point at another one
+    if (!store->contains(handle)){
+        return false;
+    }
+    index = store->indexOf(handle);
+    return true;
+}
+
+glm::vec2 ParticleView::getPosition() const {
+    size_t index;
+    if (!findIndex(index)){
+        return glm::vec2(0.0f);
+    }
+    return glm::vec2({store->x[index], store->y[index]});
+}
+
+glm::vec2 ParticleView::getLastPosition() const {
+    size_t index;
+    if (!findIndex(index)){
+        return glm::vec2(0.0f);
+    }
+    return glm::vec2({store->last_x[index], store->last_y[index]});
+}
+
+glm::vec2 ParticleView::getAcceleration() const {
+    size_t index;
+    if (!findIndex(index)){
+        return glm::vec2(0.0f);
+    }
+    return glm::vec2({store->acc_x[index], store->acc_y[index]});
+}
+
+float ParticleView::getRadius() const {
+    size_t index;
+    return findIndex(index) ? store->radius[index] : 0.0f;
+}
+
+float ParticleView::getMass() const {
+    size_t index;
+    return findIndex(index) ? store->mass[index] : 0.0f;
+}
+
+void ParticleView::setPosition(glm::vec2 p){
+    size_t index;
+    if (!findIndex(index)){
+        return;
+    }
+    store->x[index] = p.x;
+    store->y[index] = p.y;
+}
+
+void ParticleView::accelerate(const glm::vec2& a){
+    size_t index;
+    if (!findIndex(index)){
+        return;
+    }
+    store->acc_x[index] += a.x;
+    store->acc_y[index] += a.y;
+}
+
+void ParticleView::setVelocity(glm::vec2 v, float dt){
+    size_t index;
+    if (!findIndex(index)){
+        return;
+    }
+    store->last_x[index] = store->x[index] - v.x * dt;
+    store->last_y[index] = store->y[index] - v.y * dt;
+}
+
+void ParticleView::addVelocity(glm::vec2 v, float dt){
+    size_t index;
+    if (!findIndex(index)){
+        return;
+    }
+    store->last_x[index] -= v.x * dt;
+    store->last_y[index] -= v.y * dt;
+}
+
+glm::vec2 ParticleView::getVelocity() const {
+    return getPosition() - getLastPosition();
+}
+
+
+size_t ParticleStore::size() const {
+    return x.size();
+}
+
+bool ParticleStore::empty() const {
+    return x.empty();
+}
+
+void ParticleStore::reserve(size_t n){
+    x.reserve(n);
+    y.reserve(n);
+    last_x.reserve(n);
+    last_y.reserve(n);
+    acc_x.reserve(n);
+    acc_y.reserve(n);
+    radius.reserve(n);
+    mass.reserve(n);
+    rest_steps.reserve(n);
+    slot_indices.reserve(n);
+    index_slots.reserve(n);
+    generations.reserve(n);
+    free_slots.reserve(n);
+    removal_indices.reserve(n);
+    pending_removals.reserve(n);
+    permute_scratch.reserve(n);
+    permute_words.reserve(n);
+    permute_slots.reserve(n);
+}
+
+size_t ParticleStore::capacity() const {
+    return x.capacity();
+}
+
+void ParticleStore::clear(){
+    x.clear();
+    y.clear();
+    last_x.clear();
+    last_y.clear();
+    acc_x.clear();
+    acc_y.clear();
+    radius.clear();
+    mass.clear();
+    rest_steps.clear();
+    for (uint32_t slot : index_slots){
+        releaseSlot(slot);
+    }
+    index_slots.clear();
+    pending_removals.clear();
+}
+
+ParticleView ParticleStore::add(const Particle& particle){
+    x.push_back(particle.position.x);
+    y.push_back(particle.position.y);
+    last_x.push_back(particle.position_last.x);
+    last_y.push_back(particle.position_last.y);
+    acc_x.push_back(particle.acceleration.x);
+    acc_y.push_back(particle.acceleration.y);
+    radius.push_back(particle.radius);
+    mass.push_back(particle.mass);
+    rest_steps.push_back(0);
+    const uint32_t slot = acquireSlot(static_cast<uint32_t>(x.size() - 1));
+    return ParticleView(*this, {slot, generations[slot]});
+}
+
+size_t ParticleStore::addBatch(size_t count, const Particle& prototype){
+    const size_t first = x.size();
+    const size_t new_size = first + count;
+    x.resize(new_size, prototype.position.x);
+    y.resize(new_size, prototype.position.y);
+    last_x.resize(new_size, prototype.position_last.x);
+    last_y.resize(new_size, prototype.position_last.y);
+    acc_x.resize(new_size, prototype.acceleration.x);
+    acc_y.resize(new_size, prototype.acceleration.y);
+    radius.resize(new_size, prototype.radius);
+    mass.resize(new_size, prototype.mass);
+    rest_steps.resize(new_size, 0);
+    for (size_t i = first; i < new_size; ++i){
+        acquireSlot(static_cast<uint32_t>(i));
+    }
+    return first;
+}
+
+void ParticleStore::swapRemove(size_t i){
+    const size_t last = x.size() - 1;
+    x[i] = x[last];
+    y[i] = y[last];
+    last_x[i] = last_x[last];
+    last_y[i] = last_y[last];
+    acc_x[i] = acc_x[last];
+    acc_y[i] = acc_y[last];
+    radius[i] = radius[last];
+    mass[i] = mass[last];
+    rest_steps[i] = rest_steps[last];
+    x.pop_back();
+    y.pop_back();
+    last_x.pop_back();
+    last_y.pop_back();
+    acc_x.pop_back();
+    acc_y.pop_back();
+    radius.pop_back();
+    mass.pop_back();
+    rest_steps.pop_back();
+
+    releaseSlot(index_slots[i]);
+    index_slots[i] = index_slots[last];
+    slot_indices[index_slots[i]] = static_cast<uint32_t>(i);
+    index_slots.pop_back();
+}
+
+Particle ParticleStore::get(size_t i) const {
+    Particle particle(glm::vec2({x[i], y[i]}), radius[i]);
+    particle.position_last = glm::vec2({last_x[i], last_y[i]});
+    particle.acceleration = glm::vec2({acc_x[i], acc_y[i]});
+    particle.mass = mass[i];
+    return particle;
+}
+
+bool ParticleStore::contains(ParticleHandle handle) const {
+    // freeing a slot bumps its generation, so a matching generation means live
+    return handle.slot < generations.size() && generations[handle.slot] == handle.generation;
+}
+
+size_t ParticleStore::indexOf(ParticleHandle handle) const {
+    return slot_indices[handle.slot];
+}
+
+ParticleHandle ParticleStore::handleAt(size_t i) const {
+    const uint32_t slot = index_slots[i];
+    return {slot, generations[slot]};
+}
+
+void ParticleStore::markForRemoval(ParticleHandle handle){
+    pending_removals.push_back(handle);
+}
+
+const std::vector<ParticleHandle>& ParticleStore::getPendingRemovals() const {
+    return pending_removals;
+}
+
+size_t ParticleStore::compact(){
+    removal_indices.clear();
+    for (const ParticleHandle& handle : pending_removals){
+        if (contains(handle)){
+            removal_indices.push_back(slot_indices[handle.slot]);
+        }
+    }
+    pending_removals.clear();
+
+    // Descending, so every particle a swap moves down comes from past the indices
+    // still waiting. Repeated marks resolve to the same index and are dropped here.
+    std::sort(removal_indices.begin(), removal_indices.end(), std::greater<uint32_t>());
+    removal_indices.erase(std::unique(removal_indices.begin(), removal_indices.end()), removal_indices.end());
+    for (uint32_t i : removal_indices){
+        swapRemove(i);
+    }
+    return removal_indices.size();
+}
+
+void ParticleStore::permute(const std::vector<uint32_t>& order){
+    permuteArray(x, order, permute_scratch);
+    permuteArray(y, order, permute_scratch);
+    permuteArray(last_x, order, permute_scratch);
+    permuteArray(last_y, order, permute_scratch);
+    permuteArray(acc_x, order, permute_scratch);
+    permuteArray(acc_y, order, permute_scratch);
+    permuteArray(radius, order, permute_scratch);
+    permuteArray(mass, order, permute_scratch);
+    permuteArray(rest_steps, order, permute_words);
+
+    permute_slots.resize(order.size());
+    for (size_t i = 0; i < order.size(); ++i){
+        const uint32_t slot = index_slots[order[i]];
+        permute_slots[i] = slot;
+        slot_indices[slot] = static_cast<uint32_t>(i);
+    }
+    index_slots.swap(permute_slots);
+}
+
+void ParticleStore::resetHandles(){
+    for (uint32_t slot : index_slots){
+        releaseSlot(slot);
+    }
+    index_slots.clear();
+    pending_removals.clear();
+    rest_steps.assign(x.size(), 0);
+    for (size_t i = 0; i < x.size(); ++i){
+        acquireSlot(static_cast<uint32_t>(i));
+    }
+}
+
+ParticleView ParticleStore::operator[](size_t i){
+    return ParticleView(*this, handleAt(i));
+}
+
+uint32_t ParticleStore::acquireSlot(uint32_t index){
+    uint32_t slot;
+    if (!free_slots.empty()){
+        slot = free_slots.back();
+        free_slots.pop_back();
+    }
+    else {
+        slot = static_cast<uint32_t>(generations.size());
+        generations.push_back(0);
+        slot_indices.push_back(0);
+    }
+    slot_indices[slot] = index;
+    index_slots.push_back(slot);
+    return slot;
+}
+
+void ParticleStore::releaseSlot(uint32_t slot){
+    ++generations[slot];
+    free_slots.push_back(slot);
+}
+
+template <typename T>
+void ParticleStore::permuteArray(std::vector<T>& array, const std::vector<uint32_t>& order, std::vector<T>& scratch){
+    scratch.resize(order.size());
+    for (size_t i = 0; i < order.size(); ++i){
+        scratch[i] = array[order[i]];
+    }
+    // the scratch keeps the old array's storage for the next field
+    array.swap(scratch);
+}
@@ -0,0 +1,149 @@
+#define GLM_ENABLE_EXPERIMENTAL
+#ifndef PARTICLE_STORE_HPP
+#define PARTICLE_STORE_HPP
+
+#include <vector>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+#include "../particle/particle.hpp"
+
+class ParticleStore;
+
+// Stable name for a particle. The slot keeps pointing at the particle while swap
+// removals and compaction move it around the dense arrays; the generation changes
+// when the particle is removed, so a stale handle never reaches a newer particle.
+struct ParticleHandle {
+    static const uint32_t INVALID_SLOT = 0xffffffffu;
+
+    uint32_t slot = INVALID_SLOT;
+    uint32_t generation = 0;
+
+    bool operator==(const ParticleHandle& other) const {
+        return slot == other.slot && generation == other.generation;
+    }
+    bool operator!=(const ParticleHandle& other) const {
+        return !(*this == other);
+    }
+};
+
+// Accessor for one particle inside a ParticleStore. It holds a handle rather than a
+// pointer or an index, so it stays valid when the store grows or compacts. A view
+// dies with its particle: once the particle is removed, the getters return zeros
+// and the setters do nothing.
+class ParticleView {
+    public:
+        static const size_t INVALID_INDEX = static_cast<size_t>(-1);
+
+        ParticleView(ParticleStore& store_, ParticleHandle handle_);
+
+        ParticleHandle getHandle() const;
+        // false once the particle has been removed
+        bool isValid() const;
+        // current position in the dense arrays, or INVALID_INDEX once the particle is
+        // gone; changes when particles are removed
+        size_t getIndex() const;
+
+        glm::vec2 getPosition() const;
+        glm::vec2 getLastPosition() const;
+        glm::vec2 getAcceleration() const;
+        float getRadius() const;
+        float getMass() const;
+
+        void setPosition(glm::vec2 p);
+
+        void accelerate(const glm::vec2& a);
+
+        void setVelocity(glm::vec2 v, float dt);
+
+        void addVelocity(glm::vec2 v, float dt);
+
+        glm::vec2 getVelocity() const;
+
+    private:
+        ParticleStore* store;
+        ParticleHandle handle;
+
+        // the particle's index, false when it is gone
+        bool findIndex(size_t& index) const;
+};
+
+// Structure-of-arrays particle storage. Each field lives in its own contiguous
+// array so the solver kernels only stream the fields they use. Live particles are
+// always packed into [0, size()); handles reach them through a slot table, and freed
+// slots are reused through a free list, so adding and removing are both O(1).
+class ParticleStore {
+    public:
+        std::vector<float> x;
+        std::vector<float> y;
+        std::vector<float> last_x;
+        std::vector<float> last_y;
+        std::vector<float> acc_x;
+        std::vector<float> acc_y;
+        std::vector<float> radius;
+        std::vector<float> mass;
+        // steps the particle has moved slower than the solver's sleep threshold, or
+        // ASLEEP while it is skipped; new particles start awake
+        std::vector<uint32_t> rest_steps;
+        static const uint32_t ASLEEP = 0xffffffffu;
+
+        size_t size() const;
+        bool empty() const;
+        // reserves the arrays and the handle tables, so adding up to n particles
+        // never reallocates
+        void reserve(size_t n);
+        size_t capacity() const;
+        // removes every particle; their handles become stale
+        void clear();
+
+        ParticleView add(const Particle& particle);
+        // appends count copies of prototype with one resize per array and returns the
+        // index of the first; the caller then writes the per-particle fields in place
+        size_t addBatch(size_t count, const Particle& prototype);
+        // O(1): the last particle is moved into index i, so only its index changes
+        void swapRemove(size_t i);
+        Particle get(size_t i) const;
+
+        bool contains(ParticleHandle handle) const;
+        // only for handles that contains() accepts
+        size_t indexOf(ParticleHandle handle) const;
+        ParticleHandle handleAt(size_t i) const;
+
+        // Removal in two halves: marking is O(1) and leaves every index untouched, so
+        // it is safe in the middle of a sweep; compact() then swap-removes the marked
+        // particles and returns how many were removed. Stale or repeated marks are ignored.
+        void markForRemoval(ParticleHandle handle);
+        size_t compact();
+        // marks since the last compact(), stale ones included
+        const std::vector<ParticleHandle>& getPendingRemovals() const;
+
+        // reorders the arrays so that new index i holds the particle at old index
+        // order[i]; order must be a permutation of [0, size()). Handles follow their
+        // particles, indices do not.
+        void permute(const std::vector<uint32_t>& order);
+
+        // gives particles [0, size()) fresh handles after the arrays were filled
+        // directly (e.g. restored from a checkpoint) and wakes them; earlier handles
+        // become stale
+        void resetHandles();
+
+        ParticleView operator[](size_t i);
+
+    private:
+        std::vector<uint32_t> slot_indices;  // slot -> index in the arrays
+        std::vector<uint32_t> index_slots;   // index in the arrays -> slot
+        std::vector<uint32_t> generations;   // per slot, bumped when the slot is freed
+        std::vector<uint32_t> free_slots;
+        std::vector<uint32_t> removal_indices;
+        std::vector<ParticleHandle> pending_removals;
+        std::vector<float> permute_scratch;
+        std::vector<uint32_t> permute_words;
+        std::vector<uint32_t> permute_slots;
+
+        uint32_t acquireSlot(uint32_t index);
+        void releaseSlot(uint32_t slot);
+        template <typename T>
+        static void permuteArray(std::vector<T>& array, const std::vector<uint32_t>& order, std::vector<T>& scratch);
+};
+
+#endif
@@ -0,0 +1,240 @@
+#include <vector>
+#include <string>
+#include <chrono>
+#include <mutex>
+#include <fstream>
+#include <algorithm>
+#include <cstring>
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+#include "profiler.hpp"
+
+namespace {
+    const size_t MAX_TRACE_EVENTS_PER_THREAD = 1 << 20;
+
+    double toMs(Profiler::Clock::duration d) {
+        return std::chrono::duration<double, std::milli>(d).count();
+    }
+
+#ifdef __linux__
+    int openCacheCounter(uint64_t cache) {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HW_CACHE;
+        attr.config = cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        attr.inherit = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+    }
+
+    uint64_t readCounter(int fd) {
+        uint64_t value = 0;
+        if (fd < 0 || read(fd, &value, sizeof(value)) != sizeof(value)) {
+            return 0;
+        }
+        return value;
+    }
+#endif
+}
+
+const char* getPhaseName(Phase phase) {
+    switch (phase) {
+        case Phase::Step: return "step";
+        case Phase::Substep: return "substep";
+        case Phase::Grid: return "grid";
+        case Phase::Gravity: return "gravity";
+        case Phase::Integrate: return "integrate";
+        case Phase::Collision: return "collision";
+        case Phase::Boundary: return "boundary";
+        case Phase::Obstacles: return "obstacles";
+        case Phase::Fused: return "fused";
+        case Phase::Reorder: return "reorder";
+        case Phase::Contacts: return "contacts";
+        case Phase::Sleep: return "sleep";
+        case Phase::Fields: return "fields";
+        default: return "unknown";
+    }
+}
+
+Profiler::Profiler(size_t num_threads_)
+: origin(Clock::now())
+, slots(new ThreadSlot[num_threads_])
+, num_threads(num_threads_)
+, trace_enabled(false)
+, reset_requested(false)
+{
+    current.threads.resize(num_threads);
+    published.threads.resize(num_threads);
+}
+
+void Profiler::beginStep() {
+    if (!reset_requested.exchange(false)) {
+        return;
+    }
+    current = SolverStats();
+    current.threads.resize(num_threads);
+    for (size_t i = 0; i < num_threads; ++i) {
+        slots[i].stats = ThreadStats();
+        slots[i].pair_tests = 0;
+        slots[i].contacts = 0;
+    }
+}
+
+void Profiler::recordPhase(Phase phase, Clock::time_point start, Clock::time_point end) {
+    PhaseStats& stats = current.phases[static_cast<size_t>(phase)];
+    const double ms = toMs(end - start);
+    stats.total_ms += ms;
+    stats.max_ms = std::max(stats.max_ms, ms);
+    ++stats.calls;
+    addTraceEvent(0, getPhaseName(phase), start, end);
+}
+
+void Profiler::recordChunk(size_t thread, Clock::time_point start, Clock::time_point end) {
+    ThreadSlot& slot = slots[thread];
+    slot.stats.busy_ms += toMs(end - start);
+    ++slot.stats.chunks;
+    addTraceEvent(thread, "chunk", start, end);
+}
+
+void Profiler::addPairs(size_t thread, uint64_t tests, uint64_t contacts) {
+    slots[thread].pair_tests += tests;
+    slots[thread].contacts += contacts;
+}
+
+void Profiler::setGridStats(const GridStats& stats) {
+    current.grid = stats;
+}
+
+void Profiler::recordReorder(double disorder, bool reordered) {
+    current.disorder = disorder;
+    current.reorders += reordered;
+}
+
+void Profiler::endStep() {
+    ++current.steps;
+    current.pair_tests = 0;
+    current.contacts = 0;
+    for (size_t i = 0; i < num_threads; ++i) {
+        current.threads[i] = slots[i].stats;
+        current.pair_tests += slots[i].pair_tests;
+        current.contacts += slots[i].contacts;
+    }
+
+    std::lock_guard<std::mutex> lock(published_mutex);
+    published = current;
+}
+
+SolverStats Profiler::getStats() {
+    std::lock_guard<std::mutex> lock(published_mutex);
+    return published;
+}
+
+void Profiler::reset() {
+    // applied by the update thread at the start of its next step
+    reset_requested = true;
+    std::lock_guard<std::mutex> lock(published_mutex);
+    published = SolverStats();
+    published.threads.resize(num_threads);
+}
+
+void Profiler::setTraceEnabled(bool enabled) {
+    trace_enabled = enabled;
+}
+
+void Profiler::addTraceEvent(size_t thread, const char* name, Clock::time_point start, Clock::time_point end) {
+    if (!trace_enabled) {
+        return;
+    }
+    std::vector<TraceEvent>& events = slots[thread].events;
+    if (events.size() >= MAX_TRACE_EVENTS_PER_THREAD) {
+        return;
+    }
+    const int64_t start_us = std::chrono::duration_cast<std::chrono::microseconds>(start - origin).count();
+    const int64_t duration_us = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+    events.push_back({name, start_us, duration_us});
+}
+
+bool Profiler::writeTrace(const std::string& path) {
+    std::ofstream file(path);
+    if (!file) {
+        return false;
+    }
+
+    file << "{\"traceEvents\":[";
+    bool first = true;
+    for (size_t thread = 0; thread < num_threads; ++thread) {
+        for (const TraceEvent& event : slots[thread].events) {
+            file << (first ? "\n" : ",\n");
+            file << "{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << thread
+                 << ",\"ts\":" << event.start_us << ",\"dur\":" << event.duration_us << "}";
+            first = false;
+        }
+        slots[thread].events.clear();
+    }
+    file << "\n]}\n";
+    return static_cast<bool>(file);
+}
+
+#ifdef __linux__
+CacheCounters::CacheCounters()
+: l1_fd(openCacheCounter(PERF_COUNT_HW_CACHE_L1D))
+, last_level_fd(openCacheCounter(PERF_COUNT_HW_CACHE_LL))
+{}
+
+CacheCounters::~CacheCounters() {
+    if (l1_fd >= 0) {
+        close(l1_fd);
+    }
+    if (last_level_fd >= 0) {
+        close(last_level_fd);
+    }
+}
+
+bool CacheCounters::isAvailable() const {
+    return l1_fd >= 0 && last_level_fd >= 0;
+}
+
+void CacheCounters::reset() {
+    if (isAvailable()) {
+        // the reset reaches the threads' inherited counters as well
+        ioctl(l1_fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(last_level_fd, PERF_EVENT_IOC_RESET, 0);
+    }
+}
+
+uint64_t CacheCounters::getL1DataMisses() const {
+    return readCounter(l1_fd);
+}
+
+uint64_t CacheCounters::getLastLevelMisses() const {
+    return readCounter(last_level_fd);
+}
+#else
+CacheCounters::CacheCounters()
+: l1_fd(-1)
+, last_level_fd(-1)
+{}
+
+CacheCounters::~CacheCounters() {}
+
+bool CacheCounters::isAvailable() const {
+    return false;
+}
+
+void CacheCounters::reset() {}
+
+uint64_t CacheCounters::getL1DataMisses() const {
+    return 0;
+}
+
+uint64_t CacheCounters::getLastLevelMisses() const {
+    return 0;
+}
+#endif
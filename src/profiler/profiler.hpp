@@ -0,0 +1,179 @@
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+#include <vector>
+#include <string>
+#include <chrono>
+#include <mutex>
+#include <memory>
+#include <atomic>
+#include <cstdint>
+
+// Build with -DPARTICLE_PROFILING=1 to enable the solver instrumentation. When it
+// is 0 the PROFILE_* macros expand to nothing and getStats() stays empty. The
+// Profiler layout does not depend on the flag, so objects built with and without
+// it can be linked together.
+#ifndef PARTICLE_PROFILING
+#define PARTICLE_PROFILING 0
+#endif
+
+enum class Phase {
+    Step,
+    Substep,
+    Grid,
+    Gravity,
+    Integrate,
+    Collision,
+    Boundary,
+    Obstacles,
+    Fused,
+    Reorder,
+    Contacts,
+    Sleep,
+    Fields,
+    Count
+};
+
+const size_t PHASE_COUNT = static_cast<size_t>(Phase::Count);
+
+const char* getPhaseName(Phase phase);
+
+struct PhaseStats {
+    double total_ms = 0.0;
+    double max_ms = 0.0;
+    uint64_t calls = 0;
+};
+
+struct ThreadStats {
+    double busy_ms = 0.0; // time spent running parallel_for chunks
+    uint64_t chunks = 0;
+};
+
+struct GridStats {
+    uint32_t total_cells = 0;
+    uint32_t occupied_cells = 0;
+    uint32_t max_per_cell = 0;
+    double mean_per_occupied = 0.0;
+};
+
+struct SolverStats {
+    PhaseStats phases[PHASE_COUNT];
+    std::vector<ThreadStats> threads;
+    uint64_t pair_tests = 0;
+    uint64_t contacts = 0;
+    GridStats grid; // from the last grid build
+    uint64_t steps = 0;
+    uint64_t reorders = 0;
+    double disorder = 0.0; // at the last check, before any reorder it triggered
+
+    const PhaseStats& get(Phase phase) const {
+        return phases[static_cast<size_t>(phase)];
+    }
+};
+
+// Collects the solver timings. Phase timers and grid stats are recorded from the
+// update thread (thread 0 of the pool); chunk timings and pair counts go into
+// per-thread slots, so workers never contend. endStep() publishes a snapshot
+// under a mutex, so getStats() is safe from any thread.
+class Profiler {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        Profiler(size_t num_threads);
+
+        static Clock::time_point now() {
+            return Clock::now();
+        }
+
+        void beginStep();
+        void recordPhase(Phase phase, Clock::time_point start, Clock::time_point end);
+        void recordChunk(size_t thread, Clock::time_point start, Clock::time_point end);
+        void addPairs(size_t thread, uint64_t tests, uint64_t contacts);
+        void setGridStats(const GridStats& stats);
+        void recordReorder(double disorder, bool reordered);
+        void endStep();
+
+        SolverStats getStats();
+        void reset();
+
+        // Chrome trace (chrome://tracing, Perfetto) of phases and worker chunks.
+        // writeTrace must not run while the solver is stepping.
+        void setTraceEnabled(bool enabled);
+        bool writeTrace(const std::string& path);
+
+    private:
+        struct TraceEvent {
+            const char* name;
+            int64_t start_us;
+            int64_t duration_us;
+        };
+
+        struct alignas(64) ThreadSlot {
+            ThreadStats stats;
+            uint64_t pair_tests = 0;
+            uint64_t contacts = 0;
+            std::vector<TraceEvent> events;
+        };
+
+        Clock::time_point origin;
+        SolverStats current;
+        std::unique_ptr<ThreadSlot[]> slots;
+        size_t num_threads;
+        bool trace_enabled;
+        std::atomic<bool> reset_requested;
+
+        std::mutex published_mutex;
+        SolverStats published;
+
+        void addTraceEvent(size_t thread, const char* name, Clock::time_point start, Clock::time_point end);
+};
+
+// Hardware cache misses of the calling thread and of every thread it starts after
+// construction (Linux perf events). Inherited counts are only folded in when those
+// threads exit, so read them after the solver that owns the threads is gone.
+// Without perf events, or without permission to use them, isAvailable() is false.
+class CacheCounters {
+    public:
+        CacheCounters();
+        ~CacheCounters();
+        CacheCounters(const CacheCounters&) = delete;
+        CacheCounters& operator=(const CacheCounters&) = delete;
+
+        bool isAvailable() const;
+        // zeroes the counts, inherited ones included
+        void reset();
+        uint64_t getL1DataMisses() const;   // L1 data cache read misses
+        uint64_t getLastLevelMisses() const;
+
+    private:
+        int l1_fd;
+        int last_level_fd;
+};
+
+class ScopedPhase {
+    public:
+        ScopedPhase(Profiler& profiler_, Phase phase_)
+        : profiler(profiler_), phase(phase_), start(Profiler::now()) {}
+
+        ~ScopedPhase() {
+            profiler.recordPhase(phase, start, Profiler::now());
+        }
+
+    private:
+        Profiler& profiler;
+        Phase phase;
+        Profiler::Clock::time_point start;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#if PARTICLE_PROFILING
+#define PROFILE_PHASE(profiler, phase) ScopedPhase PROFILE_CONCAT(profile_scope_, __LINE__)(profiler, phase)
+#define PROFILE_CODE(code) code
+#else
+#define PROFILE_PHASE(profiler, phase) ((void)0)
+#define PROFILE_CODE(code)
+#endif
+
+#endif
@@ -1,48 +1,291 @@
 #include "renderer.hpp"
 #include <iostream>
+#include <algorithm>
+#include <cstddef>
+#include <cmath>
 
-Renderer::Renderer(Solver& solver) : solver(solver), vao(0), vbo(0) {
+#include "../constants/constants.hpp"
+
+namespace {
+    const size_t INITIAL_CAPACITY = 8192;
+
+    const char* VERTEX_SHADER = R"(
+        #version 330 core
+        layout(location = 0) in vec2 corner;
+        layout(location = 1) in vec2 position;
+        layout(location = 2) in float radius;
+        layout(location = 3) in vec4 colour;
+        uniform vec2 screen_size;
+        out vec2 local;
+        out vec4 tint;
+        void main() {
+            local = corner;
+            tint = colour;
+            vec2 pixel = position + corner * radius;
+            gl_Position = vec4(pixel / screen_size * 2.0 - 1.0, 0.0, 1.0);
+        }
+    )";
+
+    const char* FRAGMENT_SHADER = R"(
+        #version 330 core
+        in vec2 local;
+        in vec4 tint;
+        out vec4 frag_colour;
+        void main() {
+            float dist = length(local);
+            float edge = fwidth(dist);
+            float coverage = 1.0 - smoothstep(1.0 - edge, 1.0, dist);
+            if (coverage <= 0.0) {
+                discard;
+            }
+            frag_colour = vec4(tint.rgb, tint.a * coverage);
+        }
+    )";
+
+    GLuint compileShader(GLenum type, const char* source) {
+        GLuint shader = glCreateShader(type);
+        glShaderSource(shader, 1, &source, nullptr);
+        glCompileShader(shader);
+
+        GLint status = 0;
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+        if (!status) {
+            char log[1024];
+            glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+            std::cerr << "Shader compilation failed: " << log << std::endl;
+        }
+        return shader;
+    }
+
+    GLuint linkProgram() {
+        GLuint vertex = compileShader(GL_VERTEX_SHADER, VERTEX_SHADER);
+        GLuint fragment = compileShader(GL_FRAGMENT_SHADER, FRAGMENT_SHADER);
+        GLuint program = glCreateProgram();
+        glAttachShader(program, vertex);
+        glAttachShader(program, fragment);
+        glLinkProgram(program);
+        glDeleteShader(vertex);
+        glDeleteShader(fragment);
+
+        GLint status = 0;
+        glGetProgramiv(program, GL_LINK_STATUS, &status);
+        if (!status) {
+            char log[1024];
+            glGetProgramInfoLog(program, sizeof(log), nullptr, log);
+            std::cerr << "Shader link failed: " << log << std::endl;
+        }
+        return program;
+    }
+}
+
+Renderer::Renderer(Solver& solver)
+: solver(solver)
+, vao(0), quad_vbo(0), instance_vbo(0), program(0)
+, screen_size_location(-1)
+, persistent(false)
+, capacity(0)
+, mapped(nullptr)
+, segment(0)
+, fences{}
+{
     initialize();
 }
 
 Renderer::~Renderer() {
+    destroyInstanceBuffer();
+    glDeleteBuffers(1, &quad_vbo);
     glDeleteVertexArrays(1, &vao);
-    glDeleteBuffers(1, &vbo);
+    glDeleteProgram(program);
 }
 
 void Renderer::initialize() {
-    glGenVertexArrays(1, &vao);
-    glGenBuffers(1, &vbo);
+    program = linkProgram();
+    screen_size_location = glGetUniformLocation(program, "screen_size");
+    persistent = GLEW_ARB_buffer_storage;
 
-    glBindVertexArray(vao);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, 0, nullptr, GL_DYNAMIC_DRAW);
+    const glm::vec2 corners[4] = {
+        glm::vec2(-1.0f, -1.0f), glm::vec2(1.0f, -1.0f), glm::vec2(-1.0f, 1.0f), glm::vec2(1.0f, 1.0f)
+    };
 
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &quad_vbo);
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, quad_vbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2), (void*)0);
 
+    for (GLuint attribute = 1; attribute <= 3; ++attribute) {
+        glEnableVertexAttribArray(attribute);
+        glVertexAttribDivisor(attribute, 1);
+    }
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindVertexArray(0);
+
+    createInstanceBuffer(INITIAL_CAPACITY);
+}
+
+void Renderer::createInstanceBuffer(size_t instances) {
+    capacity = instances;
+    glGenBuffers(1, &instance_vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, instance_vbo);
+    const GLsizeiptr bytes = RING_SEGMENTS * capacity * sizeof(ParticleInstance);
+    if (persistent) {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_ARRAY_BUFFER, bytes, nullptr, flags);
+        mapped = static_cast<ParticleInstance*>(glMapBufferRange(GL_ARRAY_BUFFER, 0, bytes, flags));
+    }
+    else {
+        glBufferData(GL_ARRAY_BUFFER, bytes, nullptr, GL_STREAM_DRAW);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void Renderer::destroyInstanceBuffer() {
+    for (GLsync& fence : fences) {
+        if (fence) {
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+    }
+    if (mapped) {
+        glBindBuffer(GL_ARRAY_BUFFER, instance_vbo);
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        mapped = nullptr;
+    }
+    glDeleteBuffers(1, &instance_vbo);
+    instance_vbo = 0;
+}
+
+ParticleInstance* Renderer::beginSegment(size_t count) {
+    if (count > capacity) {
+        // storage is immutable, so growing means a new buffer; wait for the GPU to let go of the old one
+        glFinish();
+        destroyInstanceBuffer();
+        createInstanceBuffer(std::max(count, 2 * capacity));
+    }
+
+    segment = (segment + 1) % RING_SEGMENTS;
+    GLsync& fence = fences[segment];
+    if (fence) {
+        // only blocks when the GPU is still RING_SEGMENTS - 1 frames behind
+        while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED) {}
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, instance_vbo);
+    if (persistent) {
+        return mapped + segment * capacity;
+    }
+
+    const GLsizeiptr bytes = count * sizeof(ParticleInstance);
+    const GLintptr offset = segment * capacity * sizeof(ParticleInstance);
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT;
+    return static_cast<ParticleInstance*>(glMapBufferRange(GL_ARRAY_BUFFER, offset, std::max<GLsizeiptr>(bytes, 1), flags));
+}
+
+void Renderer::endSegment() {
+    if (!persistent) {
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void Renderer::writeInstances(const ParticleSnapshot& snapshot, float alpha, ParticleInstance* out) {
+    for (size_t i = 0; i < snapshot.size(); ++i) {
+        out[i].position = glm::mix(snapshot.previous_positions[i], snapshot.positions[i], alpha);
+        out[i].radius = snapshot.radii[i];
+        out[i].colour = getParticleColour(snapshot, i);
+    }
+}
+
+void Renderer::renderBoundary() {
+    // the inside is filled black one screen row at a time from the shape's spans,
+    // which works the same for every boundary shape
+    const Boundary& boundary = *solver.getBoundary();
+    glm::vec2 min_corner, max_corner;
+    getBoundaryBounds(boundary, min_corner, max_corner);
+    const int row_begin = std::max(0, static_cast<int>(std::floor(min_corner.y)));
+    const int row_end = std::min(static_cast<int>(GraphicsConstants::SCREEN_HEIGHT), static_cast<int>(std::ceil(max_corner.y)));
+
+    glColor3f(0.0f, 0.0f, 0.0f);
+    glBegin(GL_QUADS);
+    for (int row = row_begin; row < row_end; ++row) {
+        boundary_spans.clear();
+        getBoundarySpans(boundary, row + 0.5f, boundary_spans);
+        for (const glm::vec2& span : boundary_spans) {
+            glVertex2f(span.x, float(row));
+            glVertex2f(span.y, float(row));
+            glVertex2f(span.y, float(row + 1));
+            glVertex2f(span.x, float(row + 1));
+        }
+    }
+    glEnd();
+}
+
+void Renderer::renderObstacles() {
+    const ObstacleField& obstacles = solver.getObstacles();
+    glm::vec2 min_corner, max_corner;
+    obstacles.getBounds(min_corner, max_corner);
+    const int row_begin = std::max(0, static_cast<int>(std::floor(min_corner.y)));
+    const int row_end = std::min(static_cast<int>(GraphicsConstants::SCREEN_HEIGHT), static_cast<int>(std::ceil(max_corner.y)));
+
+    glColor3f(0.5f, 0.5f, 0.5f);
+    glBegin(GL_QUADS);
+    for (int row = row_begin; row < row_end; ++row) {
+        boundary_spans.clear();
+        obstacles.getSpans(row + 0.5f, boundary_spans);
+        for (const glm::vec2& span : boundary_spans) {
+            glVertex2f(span.x, float(row));
+            glVertex2f(span.y, float(row));
+            glVertex2f(span.y, float(row + 1));
+            glVertex2f(span.x, float(row + 1));
+        }
+    }
+    glEnd();
 }
 
 void Renderer::render() {
     if (solver.getBoundary() != nullptr) {
-        solver.renderBoundary();
+        renderBoundary();
+    }
+    if (!solver.getObstacles().empty()) {
+        renderObstacles();
     }
 
-    particle_positions.clear();
-    for (const auto& particle : solver.getObjects()) {
-        particle_positions.push_back(particle.position);
+    // never blocks: if the solver has not finished a step since the last frame the
+    // previous snapshot is drawn again
+    const ParticleSnapshot& snapshot = solver.acquireSnapshot();
+    const size_t count = snapshot.size();
+    if (count == 0) {
+        return;
     }
 
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, particle_positions.size() * sizeof(glm::vec2), particle_positions.data(), GL_DYNAMIC_DRAW);
+    ParticleInstance* instances = beginSegment(count);
+    if (!instances) {
+        endSegment();
+        return;
+    }
+    writeInstances(snapshot, solver.getInterpolationAlpha(snapshot), instances);
+    endSegment();
 
+    const size_t base = segment * capacity * sizeof(ParticleInstance);
     glBindVertexArray(vao);
-    glColor3f(0.0f, 1.0f, 1.0f);
-    glPointSize(solver.radius + 1.0f);
-    glEnable(GL_POINT_SMOOTH);
-    glHint(GL_POINT_SMOOTH_HINT, GL_NICEST);
-    glDrawArrays(GL_POINTS, 0, particle_positions.size());
+    glBindBuffer(GL_ARRAY_BUFFER, instance_vbo);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(ParticleInstance), (void*)(base + offsetof(ParticleInstance, position)));
+    glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, sizeof(ParticleInstance), (void*)(base + offsetof(ParticleInstance, radius)));
+    glVertexAttribPointer(3, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(ParticleInstance), (void*)(base + offsetof(ParticleInstance, colour)));
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glUseProgram(program);
+    glUniform2f(screen_size_location, GraphicsConstants::SCREEN_WIDTH, GraphicsConstants::SCREEN_HEIGHT);
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, static_cast<GLsizei>(count));
+    glUseProgram(0);
     glBindVertexArray(0);
+
+    fences[segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
 }
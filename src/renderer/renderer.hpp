@@ -3,26 +3,54 @@
 #define RENDERER_HPP
 
 #include <vector>
-#include <thread>
-#include <mutex>
-#include <condition_variable>
+#include <cstdint>
 
 #include <GL/glew.h>
 
 #include "../solver/solver.hpp"
 
+// Per-particle instance data written straight into the mapped VBO
+struct ParticleInstance {
+    glm::vec2 position;
+    float radius;
+    uint32_t colour; // RGBA8, read as normalised bytes
+};
+
+// Draws particles as instanced quads shaded into discs. Instances live in a ring
+// of RING_SEGMENTS regions of one persistently mapped buffer (GL 4.4 /
+// ARB_buffer_storage); each frame writes the next region and fences it, so the CPU
+// never writes a region the GPU is still reading. Without buffer storage the same
+// ring is mapped unsynchronised, one region per frame.
 class Renderer {
     public:
+        static const int RING_SEGMENTS = 3;
+
         Renderer(Solver& solver);
         ~Renderer();
         
         void initialize();
         void render();
+        void renderBoundary();
+        void renderObstacles();
     
     private:
         Solver& solver;
-        GLuint vao, vbo;
-        std::vector<glm::vec2> particle_positions;
+        GLuint vao, quad_vbo, instance_vbo, program;
+        GLint screen_size_location;
+
+        bool persistent;
+        size_t capacity; // instances per segment
+        ParticleInstance* mapped;
+        int segment;
+        GLsync fences[RING_SEGMENTS];
+
+        std::vector<glm::vec2> boundary_spans;
+
+        void createInstanceBuffer(size_t instances);
+        void destroyInstanceBuffer();
+        ParticleInstance* beginSegment(size_t count);
+        void endSegment();
+        void writeInstances(const ParticleSnapshot& snapshot, float alpha, ParticleInstance* out);
     };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,66 @@
+#include <chrono>
+#include <atomic>
+#include <cmath>
+#include <algorithm>
+
+#include "simClock.hpp"
+
+namespace {
+    int64_t toNs(SimClock::Clock::time_point time) {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+    }
+}
+
+SimClock::SimClock(int max_steps_per_tick_)
+: origin_ns(0)
+, running(false)
+, max_steps_per_tick(max_steps_per_tick_)
+, dropped_seconds(0.0)
+{}
+
+void SimClock::start(double sim_time) {
+    origin_ns.store(toNs(Clock::now()) - static_cast<int64_t>(sim_time * 1e9), std::memory_order_relaxed);
+    running.store(true, std::memory_order_release);
+}
+
+bool SimClock::isRunning() const {
+    return running.load(std::memory_order_acquire);
+}
+
+int SimClock::getDueSteps(double sim_time, float step_dt) {
+    const double lag = now() - sim_time;
+    if (lag < step_dt) {
+        return 0;
+    }
+
+    const int max_steps = max_steps_per_tick.load(std::memory_order_relaxed);
+    const double due = std::floor(lag / step_dt);
+    if (due > max_steps) {
+        const double dropped = (due - max_steps) * step_dt;
+        origin_ns.fetch_add(static_cast<int64_t>(dropped * 1e9), std::memory_order_relaxed);
+        dropped_seconds += dropped;
+        return max_steps;
+    }
+    return static_cast<int>(due);
+}
+
+SimClock::Clock::time_point SimClock::getWallTime(double sim_time) const {
+    const int64_t wall_ns = origin_ns.load(std::memory_order_relaxed) + static_cast<int64_t>(sim_time * 1e9);
+    return Clock::time_point(std::chrono::duration_cast<Clock::duration>(std::chrono::nanoseconds(wall_ns)));
+}
+
+double SimClock::now() const {
+    return (toNs(Clock::now()) - origin_ns.load(std::memory_order_relaxed)) * 1e-9;
+}
+
+void SimClock::setMaxStepsPerTick(int steps) {
+    max_steps_per_tick.store(std::max(1, steps), std::memory_order_relaxed);
+}
+
+int SimClock::getMaxStepsPerTick() const {
+    return max_steps_per_tick.load(std::memory_order_relaxed);
+}
+
+double SimClock::getDroppedSeconds() const {
+    return dropped_seconds;
+}
@@ -0,0 +1,38 @@
+#ifndef SIM_CLOCK_HPP
+#define SIM_CLOCK_HPP
+
+#include <chrono>
+#include <atomic>
+#include <cstdint>
+
+// Maps wall-clock time onto the simulation timeline for a fixed-timestep loop.
+// The update thread asks how many steps are due for its current sim time, runs
+// them and sleeps until the next one. When it falls more than max_steps_per_tick
+// behind, the backlog is dropped by moving the origin forward, so the simulation
+// slows down under load instead of spiralling. now() is safe from any thread.
+class SimClock {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        SimClock(int max_steps_per_tick_);
+
+        // aligns the timeline so that sim_time is "now"
+        void start(double sim_time);
+        bool isRunning() const;
+
+        int getDueSteps(double sim_time, float step_dt);
+        Clock::time_point getWallTime(double sim_time) const;
+        double now() const;
+
+        void setMaxStepsPerTick(int steps);
+        int getMaxStepsPerTick() const;
+        double getDroppedSeconds() const;
+
+    private:
+        std::atomic<int64_t> origin_ns;
+        std::atomic<bool> running;
+        std::atomic<int> max_steps_per_tick;
+        double dropped_seconds;
+};
+
+#endif
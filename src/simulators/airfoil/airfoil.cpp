@@ -0,0 +1,195 @@
+#define GLM_ENABLE_EXPERIMENTAL
+
+#include <vector>
+#include <mutex>
+#include <iostream>
+#include <cmath>
+#include <glm/glm.hpp>
+
+#include "../../constants/constants.hpp"
+#include "../../particle/particle.hpp"
+#include "../../boundaries/boundaries.hpp"
+#include "../../solver/solver.hpp"
+#include "../../obstacles/obstacles.hpp"
+
+#include "airfoil.hpp"
+
+namespace {
+    const int PROFILE_POINTS_PER_SIDE = 100;
+    // samples kept when nobody takes them, about a minute of steps
+    const size_t MAX_PENDING_SAMPLES = 4096;
+    const float TUNNEL_HEADROOM = 1.25f;
+    const float DEGREES_TO_RADIANS = 3.14159265359f / 180.0f;
+}
+
+AirFoilSimulator::AirFoilSimulator(const WindTunnelConfig& config_)
+: config(config_)
+, solver(config_.particle_radius)
+, spacing(config_.spacing * config_.particle_radius)
+{
+    density = Particle(glm::vec2(0.0f), config.particle_radius).mass / (spacing * spacing);
+    solver.setGravity({0.0f, 0.0f});
+
+    // Walls above and below. The side walls sit a few lattice rows outside the
+    // tunnel, so particles reach the outlet line before they reach a wall.
+    const float side_margin = 4.0f * spacing;
+    RectBoundingArea walls;
+    walls.top_line = config.min_corner.y;
+    walls.bottom_line = config.max_corner.y;
+    walls.left_side = config.min_corner.x - side_margin;
+    walls.right_side = config.max_corner.x + side_margin;
+    solver.addBoundary(walls);
+
+    buildObstacle();
+
+    for (float y = config.min_corner.y + 0.5f * spacing; y < config.max_corner.y - 0.5f * config.particle_radius; y += spacing){
+        inlet_slots.push_back(glm::vec2(config.min_corner.x + 0.5f * spacing, y));
+    }
+    // the initial lattice plus headroom for the flow compressing ahead of the obstacle
+    const float columns = (config.max_corner.x - config.min_corner.x) / spacing + 1.0f;
+    solver.setMaxObjects(static_cast<size_t>(TUNNEL_HEADROOM * columns * inlet_slots.size()));
+    fillTunnel();
+
+    solver.setStepHook([this](Solver& s) { stepBoundaries(s); });
+}
+
+Solver& AirFoilSimulator::getSolver(){
+    return solver;
+}
+
+const WindTunnelConfig& AirFoilSimulator::getConfig() const {
+    return config;
+}
+
+float AirFoilSimulator::getFreestreamDensity() const {
+    return density;
+}
+
+void AirFoilSimulator::takeSamples(std::vector<FlowSample>& out){
+    out.clear();
+    std::lock_guard<std::mutex> lock(samples_mutex);
+    out.swap(samples);
+}
+
+void AirFoilSimulator::buildObstacle(){
+    if (config.naca.empty()){
+        return;
+    }
+    std::vector<glm::vec2> profile = makeNacaProfile(config.naca, config.chord, PROFILE_POINTS_PER_SIDE);
+    if (profile.empty()){
+        std::cerr << "NACA " << config.naca << " is not a 4-digit section, the tunnel is empty" << std::endl;
+        return;
+    }
+    // nose up means a clockwise turn with the flow going to +x
+    placePoints(profile, config.leading_edge, -config.angle_of_attack * DEGREES_TO_RADIANS);
+
+    ObstacleField field;
+    field.addPolygon(std::move(profile));
+    field.bake(0.5f * config.particle_radius, 4.0f * config.particle_radius);
+    solver.setObstacles(std::move(field));
+}
+
+void AirFoilSimulator::fillTunnel(){
+    // start from a uniform flow so the tunnel reaches steady state quickly
+    const float substep_dt = solver.getSubstepdt();
+    const glm::vec2 velocity = glm::vec2(config.air_speed, 0.0f);
+    const ObstacleField& obstacles = solver.getObstacles();
+    for (float x = config.min_corner.x + 0.5f * spacing; x < config.max_corner.x; x += spacing){
+        for (const glm::vec2& slot : inlet_slots){
+            const glm::vec2 position = glm::vec2(x, slot.y);
+            float distance;
+            glm::vec2 normal;
+            if (obstacles.sample(position, distance, normal) && distance < spacing){
+                continue;
+            }
+            solver.addObject(position).setVelocity(velocity, substep_dt);
+        }
+    }
+}
+
+void AirFoilSimulator::stepBoundaries(Solver& solver_){
+    if (solver_.getStepCount() == 0){
+        return;
+    }
+    ParticleStore& objects = solver_.getObjects();
+    const float outlet = config.max_corner.x;
+
+    free_slots.clear();
+    for (size_t i = 0; i < objects.size(); ++i){
+        if (objects.x[i] > outlet){
+            free_slots.push_back(i);
+        }
+    }
+
+    size_t spawned = 0;
+    size_t recycled = 0;
+    size_t removed = 0;
+    if (config.flow_boundary == FlowBoundary::Periodic){
+        // shift by the tunnel length, keeping height and velocity; the collision pass
+        // separates any overlap with particles near the inlet
+        const float length = config.max_corner.x - config.min_corner.x;
+        for (size_t i : free_slots){
+            objects.x[i] -= length;
+            objects.last_x[i] -= length;
+        }
+        recycled = free_slots.size();
+    }
+    else {
+        const float substep_dt = solver_.getSubstepdt();
+        const glm::vec2 velocity = glm::vec2(config.air_speed, 0.0f);
+        const glm::vec2 displacement = velocity * substep_dt;
+        for (const glm::vec2& slot : inlet_slots){
+            if (!solver_.isSpaceFree(slot, spacing - config.particle_radius)){
+                continue;
+            }
+            if (!free_slots.empty()){
+                const size_t i = free_slots.back();
+                free_slots.pop_back();
+                objects.x[i] = slot.x;
+                objects.y[i] = slot.y;
+                objects.last_x[i] = slot.x - displacement.x;
+                objects.last_y[i] = slot.y - displacement.y;
+                objects.acc_x[i] = 0.0f;
+                objects.acc_y[i] = 0.0f;
+                ++recycled;
+            }
+            else if (objects.size() < solver_.getMaxObjects()){
+                solver_.addObject(slot).setVelocity(velocity, substep_dt);
+                ++spawned;
+            }
+        }
+        // the solver compacts marked particles away once the hook returns
+        removed = free_slots.size();
+        for (size_t i : free_slots){
+            objects.markForRemoval(objects.handleAt(i));
+        }
+    }
+    recordSample(spawned, recycled, removed);
+}
+
+void AirFoilSimulator::recordSample(size_t spawned, size_t recycled, size_t removed){
+    // the hook runs before the step, so the obstacle force is that of the pending step
+    if (has_pending_sample){
+        const glm::vec2 force = solver.getObstacleForce();
+        const float dynamic_pressure = 0.5f * density * config.air_speed * config.air_speed;
+        const float reference = dynamic_pressure * config.chord;
+        pending_sample.drag = force.x;
+        pending_sample.lift = force.y;
+        pending_sample.drag_coefficient = reference > 0.0f ? force.x / reference : 0.0f;
+        pending_sample.lift_coefficient = reference > 0.0f ? force.y / reference : 0.0f;
+
+        std::lock_guard<std::mutex> lock(samples_mutex);
+        if (samples.size() >= MAX_PENDING_SAMPLES){
+            samples.erase(samples.begin(), samples.begin() + MAX_PENDING_SAMPLES / 2);
+        }
+        samples.push_back(pending_sample);
+    }
+
+    pending_sample = FlowSample();
+    pending_sample.step = solver.getStepCount();
+    pending_sample.particles = solver.getObjects().size() - removed; // the removed ones are only marked so far
+    pending_sample.spawned = spawned;
+    pending_sample.recycled = recycled;
+    pending_sample.removed = removed;
+    has_pending_sample = true;
+}
@@ -0,0 +1,93 @@
+#define GLM_ENABLE_EXPERIMENTAL
+#ifndef AIRFOIL_SIMULATOR_HPP
+#define AIRFOIL_SIMULATOR_HPP
+
+#include <vector>
+#include <string>
+#include <mutex>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+#include "../../constants/constants.hpp"
+#include "../../solver/solver.hpp"
+#include "../../obstacles/obstacles.hpp"
+
+// What happens to particles that cross the outlet
+enum class FlowBoundary {
+    Outflow,  // recycled into the inlet emitter, surplus ones are removed
+    Periodic  // re-enter at the inlet with the same height and velocity
+};
+
+struct WindTunnelConfig {
+    glm::vec2 min_corner = glm::vec2(0.0f);
+    glm::vec2 max_corner = glm::vec2(GraphicsConstants::SCREEN_WIDTH, GraphicsConstants::SCREEN_HEIGHT);
+    float particle_radius = 1.33f;
+    float spacing = 2.2f;          // inlet and initial lattice spacing, in particle radii
+    float air_speed = 200.0f;      // freestream speed along +x, units per second
+    FlowBoundary flow_boundary = FlowBoundary::Outflow;
+
+    std::string naca = "2412";     // empty for an empty tunnel
+    float chord = 300.0f;
+    float angle_of_attack = 5.0f;  // degrees, nose up
+    glm::vec2 leading_edge = glm::vec2(350.0f, 400.0f);
+};
+
+// Forces on the airfoil over one step. Drag is along the flow (+x), lift across it (+y).
+struct FlowSample {
+    uint64_t step;    // the solver's step count when the step started
+    float drag;
+    float lift;
+    float drag_coefficient;
+    float lift_coefficient;
+    size_t particles;
+    size_t spawned;   // new particles appended at the inlet
+    size_t recycled;  // outlet particles reused at the inlet
+    size_t removed;   // outlet particles with no free inlet slot
+};
+
+// Wind tunnel around a NACA airfoil. Air enters on the left through an inlet emitter,
+// leaves on the right and is bounded by walls above and below. All per-step work
+// runs in the solver's step hook, so the tunnel works with the update thread:
+//   - inlet slots are checked against the spatial grid, not against every particle
+//   - outlet particles go on a free list and are reused by the inlet; the rest are
+//     marked for removal and compacted by the solver, so nothing is erased from
+//     the middle of the arrays
+//   - the obstacle force of every step is turned into a FlowSample; the hook only
+//     sees a step's force once it has run, so a sample is published at the next hook
+class AirFoilSimulator {
+    public:
+        AirFoilSimulator(const WindTunnelConfig& config_ = WindTunnelConfig());
+        AirFoilSimulator(const AirFoilSimulator&) = delete;
+        AirFoilSimulator& operator=(const AirFoilSimulator&) = delete;
+
+        Solver& getSolver();
+        const WindTunnelConfig& getConfig() const;
+
+        // moves the samples recorded since the last call into out; thread-safe
+        void takeSamples(std::vector<FlowSample>& out);
+
+        // mass per unit area of the incoming air, used for the coefficients
+        float getFreestreamDensity() const;
+
+    private:
+        WindTunnelConfig config;
+        Solver solver;
+        float spacing;
+        float density;
+
+        std::vector<glm::vec2> inlet_slots;
+        std::vector<size_t> free_slots;
+
+        std::mutex samples_mutex;
+        std::vector<FlowSample> samples;
+        // the step running now, completed with its force at the next hook
+        FlowSample pending_sample;
+        bool has_pending_sample = false;
+
+        void buildObstacle();
+        void fillTunnel();
+        void stepBoundaries(Solver& solver_);
+        void recordSample(size_t spawned, size_t recycled, size_t removed);
+};
+
+#endif
@@ -0,0 +1,129 @@
+#define GLM_ENABLE_EXPERIMENTAL
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <glm/glm.hpp>
+
+#include "../particleStore/particleStore.hpp"
+
+#include "sleepTracker.hpp"
+
+void SleepTracker::reserve(size_t num_objects) {
+    step_x.reserve(num_objects);
+    step_y.reserve(num_objects);
+    order.reserve(num_objects);
+    parents.reserve(num_objects);
+    restless.reserve(num_objects);
+}
+
+bool SleepTracker::partition(ParticleStore& objects, size_t& awake_count) {
+    const uint32_t* rest_steps = objects.rest_steps.data();
+    const size_t count = objects.size();
+    awake_count = 0;
+    bool sorted = true;
+    bool seen_asleep = false;
+    for (size_t i = 0; i < count; ++i) {
+        const bool asleep = rest_steps[i] == ParticleStore::ASLEEP;
+        awake_count += !asleep;
+        sorted &= asleep || !seen_asleep;
+        seen_asleep |= asleep;
+    }
+    if (sorted) {
+        return false;
+    }
+
+    order.resize(count);
+    size_t awake = 0;
+    size_t asleep = awake_count;
+    for (size_t i = 0; i < count; ++i) {
+        if (rest_steps[i] == ParticleStore::ASLEEP) {
+            order[asleep++] = static_cast<uint32_t>(i);
+        }
+        else {
+            order[awake++] = static_cast<uint32_t>(i);
+        }
+    }
+    objects.permute(order);
+    return true;
+}
+
+void SleepTracker::resizePositions(size_t num_objects) {
+    step_x.resize(num_objects);
+    step_y.resize(num_objects);
+}
+
+void SleepTracker::recordPositions(const ParticleStore& objects, size_t start, size_t end) {
+    std::copy(objects.x.begin() + start, objects.x.begin() + end, step_x.begin() + start);
+    std::copy(objects.y.begin() + start, objects.y.begin() + end, step_y.begin() + start);
+}
+
+size_t SleepTracker::countRestSteps(ParticleStore& objects, float max_displacement, uint32_t steps, size_t start, size_t end) const {
+    const float* xs = objects.x.data();
+    const float* ys = objects.y.data();
+    uint32_t* rest_steps = objects.rest_steps.data();
+    const float limit2 = max_displacement * max_displacement;
+    size_t resting = 0;
+    for (size_t i = start; i < end; ++i) {
+        const float dx = xs[i] - step_x[i];
+        const float dy = ys[i] - step_y[i];
+        // saturates below ASLEEP
+        rest_steps[i] = dx * dx + dy * dy < limit2 ? std::min(rest_steps[i] + 1, steps) : 0;
+        resting += rest_steps[i] >= steps;
+    }
+    return resting;
+}
+
+void SleepTracker::beginIslands(size_t count) {
+    parents.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        parents[i] = static_cast<uint32_t>(i);
+    }
+}
+
+uint32_t SleepTracker::findRoot(uint32_t i) {
+    while (parents[i] != i) {
+        // path halving keeps the trees flat without a second pass
+        parents[i] = parents[parents[i]];
+        i = parents[i];
+    }
+    return i;
+}
+
+void SleepTracker::unite(uint32_t i, uint32_t j) {
+    const uint32_t root_i = findRoot(i);
+    const uint32_t root_j = findRoot(j);
+    // the smaller index becomes the root, so the islands do not depend on the pair order
+    if (root_i < root_j) {
+        parents[root_j] = root_i;
+    }
+    else if (root_j < root_i) {
+        parents[root_i] = root_j;
+    }
+}
+
+size_t SleepTracker::sleepIslands(ParticleStore& objects, uint32_t steps) {
+    const size_t count = parents.size();
+    uint32_t* rest_steps = objects.rest_steps.data();
+    restless.assign(count, 0);
+    for (size_t i = 0; i < count; ++i) {
+        if (rest_steps[i] < steps) {
+            restless[findRoot(static_cast<uint32_t>(i))] = 1;
+        }
+    }
+
+    size_t slept = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (restless[findRoot(static_cast<uint32_t>(i))]) {
+            continue;
+        }
+        // at rest exactly, so a sleeping particle that moves or accelerates was disturbed
+        rest_steps[i] = ParticleStore::ASLEEP;
+        objects.last_x[i] = objects.x[i];
+        objects.last_y[i] = objects.y[i];
+        objects.acc_x[i] = 0.0f;
+        objects.acc_y[i] = 0.0f;
+        ++slept;
+    }
+    return slept;
+}
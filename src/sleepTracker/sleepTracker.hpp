@@ -0,0 +1,52 @@
+#define GLM_ENABLE_EXPERIMENTAL
+#ifndef SLEEP_TRACKER_HPP
+#define SLEEP_TRACKER_HPP
+
+#include <vector>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+#include "../particleStore/particleStore.hpp"
+
+// Sleep bookkeeping on top of ParticleStore::rest_steps. The solver keeps the awake
+// particles packed in front of the sleeping ones, so every per-particle pass runs over
+// a prefix of the arrays. A particle that rests long enough only falls asleep together
+// with the island of touching particles it belongs to, once every member rests too.
+class SleepTracker {
+    public:
+        void reserve(size_t num_objects);
+
+        // Stable partition of the arrays, awake particles first, so both halves keep
+        // their memory order. Permutes only when some particle is on the wrong side;
+        // returns whether it did, with the number of awake particles in awake_count.
+        bool partition(ParticleStore& objects, size_t& awake_count);
+
+        // positions at the start of the step, over [start, end)
+        void resizePositions(size_t num_objects);
+        void recordPositions(const ParticleStore& objects, size_t start, size_t end);
+        // Counts a step at rest for the awake particles in [start, end) that moved less
+        // than max_displacement since recordPositions and restarts the others. The whole
+        // step is measured rather than the last substep, so particles that a wall or the
+        // pile above keeps pushing back and forth in place still rest. Returns how many
+        // have rested for at least steps.
+        size_t countRestSteps(ParticleStore& objects, float max_displacement, uint32_t steps, size_t start, size_t end) const;
+
+        // Islands over the awake particles [0, count): beginIslands starts every
+        // particle on its own, unite joins the islands of a touching pair, and
+        // sleepIslands puts every island whose members all rested for steps to sleep.
+        // Returns how many particles fell asleep.
+        void beginIslands(size_t count);
+        void unite(uint32_t i, uint32_t j);
+        size_t sleepIslands(ParticleStore& objects, uint32_t steps);
+
+    private:
+        std::vector<float> step_x;
+        std::vector<float> step_y;
+        std::vector<uint32_t> order;
+        std::vector<uint32_t> parents;
+        std::vector<uint8_t> restless; // per island root: some member is still moving
+
+        uint32_t findRoot(uint32_t i);
+};
+
+#endif
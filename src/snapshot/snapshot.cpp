@@ -0,0 +1,54 @@
+#include <atomic>
+#include <cstdint>
+#include <algorithm>
+#include <glm/glm.hpp>
+
+#include "snapshot.hpp"
+
+namespace {
+    const float COLOUR_MAX_SPEED = 400.0f; // px/s at which particles are drawn fully white
+}
+
+uint32_t getParticleColour(const ParticleSnapshot& snapshot, size_t i) {
+    const float distance = glm::length(snapshot.positions[i] - snapshot.previous_positions[i]);
+    const float speed = snapshot.step_dt > 0.0f ? distance / snapshot.step_dt : 0.0f;
+    const float t = std::min(1.0f, speed / COLOUR_MAX_SPEED);
+    const uint32_t red = static_cast<uint32_t>(255.0f * t);
+    return red | (255u << 8) | (255u << 16) | (255u << 24);
+}
+
+SnapshotBuffer::SnapshotBuffer()
+: back(0)
+, front(1)
+, middle(2)
+{}
+
+void SnapshotBuffer::reserve(size_t count) {
+    for (ParticleSnapshot& buffer : buffers) {
+        buffer.positions.reserve(count);
+        buffer.previous_positions.reserve(count);
+        buffer.radii.reserve(count);
+    }
+}
+
+ParticleSnapshot& SnapshotBuffer::beginWrite() {
+    return buffers[back];
+}
+
+void SnapshotBuffer::publish() {
+    // release: the snapshot contents become visible before the index does
+    const uint8_t previous = middle.exchange(back | FRESH_BIT, std::memory_order_acq_rel);
+    back = previous & INDEX_MASK;
+}
+
+const ParticleSnapshot& SnapshotBuffer::acquire() {
+    if (hasNewSnapshot()) {
+        const uint8_t previous = middle.exchange(front, std::memory_order_acq_rel);
+        front = previous & INDEX_MASK;
+    }
+    return buffers[front];
+}
+
+bool SnapshotBuffer::hasNewSnapshot() const {
+    return (middle.load(std::memory_order_relaxed) & FRESH_BIT) != 0;
+}
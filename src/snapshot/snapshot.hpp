@@ -0,0 +1,62 @@
+#define GLM_ENABLE_EXPERIMENTAL
+#ifndef SNAPSHOT_HPP
+#define SNAPSHOT_HPP
+
+#include <vector>
+#include <atomic>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+// Read-only copy of the particle state handed from the update thread to the renderer.
+// previous_positions holds the same particles at the start of the step, so a
+// renderer can interpolate between the two.
+struct ParticleSnapshot {
+    std::vector<glm::vec2> positions;
+    std::vector<glm::vec2> previous_positions;
+    std::vector<float> radii;
+    uint64_t step = 0;
+    double sim_time = 0.0; // at the end of the step
+    float step_dt = 0.0f;
+    glm::vec2 obstacle_force = glm::vec2(0.0f); // net force the obstacles received over the step
+    float contact_residual = 0.0f; // deepest overlap the last contact iteration met, with contact iterations on
+
+    size_t size() const {
+        return positions.size();
+    }
+};
+
+// RGBA8 colour (R in the low byte) shared by the renderers: cyan at rest, fading to
+// white with the particle's speed over the step
+uint32_t getParticleColour(const ParticleSnapshot& snapshot, size_t i);
+
+// Lock-free triple buffer with one writer and one reader. The writer fills its back
+// buffer and swaps it with the shared middle slot; the reader swaps its front buffer
+// with the middle slot only when a newer snapshot is waiting. Neither side ever
+// blocks, and the reader always sees a complete snapshot.
+class SnapshotBuffer {
+    public:
+        SnapshotBuffer();
+
+        // sizes all three buffers for count particles; only before the reader starts
+        void reserve(size_t count);
+
+        // writer side
+        ParticleSnapshot& beginWrite();
+        void publish();
+
+        // reader side: returns the newest published snapshot, which stays valid
+        // until the next acquire
+        const ParticleSnapshot& acquire();
+        bool hasNewSnapshot() const;
+
+    private:
+        static const uint8_t INDEX_MASK = 0x3;
+        static const uint8_t FRESH_BIT = 0x4;
+
+        ParticleSnapshot buffers[3];
+        uint8_t back;
+        uint8_t front;
+        alignas(64) std::atomic<uint8_t> middle;
+};
+
+#endif
@@ -0,0 +1,212 @@
+#define GLM_ENABLE_EXPERIMENTAL
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+#include "../constants/constants.hpp"
+#include "../boundaries/boundaries.hpp"
+#include "../obstacles/obstacles.hpp"
+#include "../threadPool/threadPool.hpp"
+#include "../snapshot/snapshot.hpp"
+
+#include "softwareRenderer.hpp"
+
+namespace {
+    const uint32_t WHITE = 0xffffffffu;
+    const uint32_t BLACK = 0xff000000u;
+    const uint32_t GREY = 0xff808080u;
+    const size_t TRANSFORM_CHUNK = 4096;
+
+    // src over dst with 8-bit coverage; the result is opaque
+    inline uint32_t blend(uint32_t dst, uint32_t src, uint32_t coverage) {
+        const uint32_t inverse = 255 - coverage;
+        uint32_t out = 0xff000000u;
+        for (int shift = 0; shift < 24; shift += 8) {
+            const uint32_t s = (src >> shift) & 0xff;
+            const uint32_t d = (dst >> shift) & 0xff;
+            out |= ((s * coverage + d * inverse + 127) / 255) << shift;
+        }
+        return out;
+    }
+}
+
+SoftwareRenderer::SoftwareRenderer(int width_, int height_, size_t num_threads)
+: width(width_)
+, height(height_)
+, num_strips((height_ + STRIP_ROWS - 1) / STRIP_ROWS)
+, thread_pool(num_threads > 0 ? num_threads - 1 : 0) // the calling thread takes part as well
+, pixels(static_cast<size_t>(width_) * height_, WHITE)
+, background(WHITE)
+, obstacles(nullptr)
+{
+    setView(glm::vec2(0.0f), glm::vec2(GraphicsConstants::SCREEN_WIDTH, GraphicsConstants::SCREEN_HEIGHT));
+}
+
+void SoftwareRenderer::setView(glm::vec2 world_min, glm::vec2 world_max) {
+    const glm::vec2 extent = world_max - world_min;
+    scale = std::min(width / extent.x, height / extent.y);
+    // centre the view on the axis with spare pixels
+    const glm::vec2 image_extent = glm::vec2(width, height) / scale;
+    view_origin = world_min - 0.5f * (image_extent - extent);
+}
+
+void SoftwareRenderer::setBackground(uint32_t colour) {
+    background = colour;
+}
+
+void SoftwareRenderer::setObstacles(const ObstacleField* obstacles_) {
+    obstacles = obstacles_;
+}
+
+const std::vector<uint32_t>& SoftwareRenderer::getPixels() const {
+    return pixels;
+}
+
+int SoftwareRenderer::getWidth() const {
+    return width;
+}
+
+int SoftwareRenderer::getHeight() const {
+    return height;
+}
+
+void SoftwareRenderer::render(const ParticleSnapshot& snapshot, const Boundary* boundary, float alpha) {
+    transformParticles(snapshot, alpha);
+    binParticles();
+    thread_pool.parallel_for(0, num_strips, 1, [this, boundary](size_t start, size_t end) {
+        for (size_t strip = start; strip < end; ++strip) {
+            renderStrip(static_cast<int>(strip), boundary);
+        }
+    });
+}
+
+void SoftwareRenderer::transformParticles(const ParticleSnapshot& snapshot, float alpha) {
+    const size_t count = snapshot.size();
+    centers.resize(count);
+    radii.resize(count);
+    colours.resize(count);
+    thread_pool.parallel_for(0, count, TRANSFORM_CHUNK, [&](size_t start, size_t end) {
+        for (size_t i = start; i < end; ++i) {
+            const glm::vec2 world = glm::mix(snapshot.previous_positions[i], snapshot.positions[i], alpha);
+            // image rows run top to bottom
+            centers[i] = glm::vec2((world.x - view_origin.x) * scale, height - (world.y - view_origin.y) * scale);
+            radii[i] = snapshot.radii[i] * scale;
+            colours[i] = getParticleColour(snapshot, i);
+        }
+    });
+}
+
+void SoftwareRenderer::binParticles() {
+    // counting sort of particles into the strips their anti-aliased extent touches
+    strip_start.assign(num_strips + 1, 0);
+    auto stripRange = [this](size_t i, int& first, int& last) {
+        const float reach = radii[i] + 0.5f;
+        if (centers[i].x + reach < 0.0f || centers[i].x - reach > width) {
+            first = 0;
+            last = -1;
+            return;
+        }
+        first = std::max(0, static_cast<int>(std::floor((centers[i].y - reach) / STRIP_ROWS)));
+        last = std::min(num_strips - 1, static_cast<int>(std::floor((centers[i].y + reach) / STRIP_ROWS)));
+    };
+
+    int first, last;
+    for (size_t i = 0; i < centers.size(); ++i) {
+        stripRange(i, first, last);
+        for (int strip = first; strip <= last; ++strip) {
+            ++strip_start[strip + 1];
+        }
+    }
+    for (int strip = 0; strip < num_strips; ++strip) {
+        strip_start[strip + 1] += strip_start[strip];
+    }
+
+    strip_particles.resize(strip_start[num_strips]);
+    std::vector<uint32_t> cursor(strip_start.begin(), strip_start.end() - 1);
+    for (size_t i = 0; i < centers.size(); ++i) {
+        stripRange(i, first, last);
+        for (int strip = first; strip <= last; ++strip) {
+            strip_particles[cursor[strip]++] = static_cast<uint32_t>(i);
+        }
+    }
+}
+
+void SoftwareRenderer::renderStrip(int strip, const Boundary* boundary) {
+    const int row_begin = strip * STRIP_ROWS;
+    const int row_end = std::min(height, row_begin + STRIP_ROWS);
+    std::fill(pixels.begin() + static_cast<size_t>(row_begin) * width, pixels.begin() + static_cast<size_t>(row_end) * width, background);
+
+    if (boundary) {
+        fillBoundary(row_begin, row_end, boundary);
+    }
+    if (obstacles && !obstacles->empty()) {
+        fillObstacles(row_begin, row_end);
+    }
+    for (uint32_t k = strip_start[strip]; k < strip_start[strip + 1]; ++k) {
+        drawDisc(row_begin, row_end, strip_particles[k]);
+    }
+}
+
+void SoftwareRenderer::fillBoundary(int row_begin, int row_end, const Boundary* boundary) {
+    // the inside of the boundary is drawn black, as in Renderer
+    std::vector<glm::vec2> spans;
+    for (int row = row_begin; row < row_end; ++row) {
+        // world y of the pixel centre
+        const float world_y = view_origin.y + (height - (row + 0.5f)) / scale;
+        spans.clear();
+        getBoundarySpans(*boundary, world_y, spans);
+        fillSpans(row, spans, BLACK);
+    }
+}
+
+void SoftwareRenderer::fillObstacles(int row_begin, int row_end) {
+    std::vector<glm::vec2> spans;
+    for (int row = row_begin; row < row_end; ++row) {
+        const float world_y = view_origin.y + (height - (row + 0.5f)) / scale;
+        spans.clear();
+        obstacles->getSpans(world_y, spans);
+        fillSpans(row, spans, GREY);
+    }
+}
+
+void SoftwareRenderer::fillSpans(int row, const std::vector<glm::vec2>& spans, uint32_t colour) {
+    uint32_t* line = pixels.data() + static_cast<size_t>(row) * width;
+    for (const glm::vec2& span : spans) {
+        const int x_begin = std::max(0, static_cast<int>(std::ceil((span.x - view_origin.x) * scale - 0.5f)));
+        const int x_end = std::min(width, static_cast<int>(std::floor((span.y - view_origin.x) * scale - 0.5f)) + 1);
+        if (x_begin < x_end) {
+            std::fill(line + x_begin, line + x_end, colour);
+        }
+    }
+}
+
+void SoftwareRenderer::drawDisc(int row_begin, int row_end, size_t particle) {
+    const glm::vec2 center = centers[particle];
+    const float radius = radii[particle];
+    const float reach = radius + 0.5f;
+    const uint32_t colour = colours[particle];
+
+    const int y_begin = std::max(row_begin, static_cast<int>(std::floor(center.y - reach)));
+    const int y_end = std::min(row_end, static_cast<int>(std::ceil(center.y + reach)) + 1);
+    const int x_begin = std::max(0, static_cast<int>(std::floor(center.x - reach)));
+    const int x_end = std::min(width, static_cast<int>(std::ceil(center.x + reach)) + 1);
+
+    for (int row = y_begin; row < y_end; ++row) {
+        uint32_t* line = pixels.data() + static_cast<size_t>(row) * width;
+        const float dy = row + 0.5f - center.y;
+        for (int x = x_begin; x < x_end; ++x) {
+            const float dx = x + 0.5f - center.x;
+            // one-pixel linear ramp across the edge
+            const float coverage = reach - std::sqrt(dx * dx + dy * dy);
+            if (coverage >= 1.0f) {
+                line[x] = colour;
+            }
+            else if (coverage > 0.0f) {
+                line[x] = blend(line[x], colour, static_cast<uint32_t>(coverage * 255.0f + 0.5f));
+            }
+        }
+    }
+}
@@ -0,0 +1,66 @@
+#define GLM_ENABLE_EXPERIMENTAL
+#ifndef SOFTWARE_RENDERER_HPP
+#define SOFTWARE_RENDERER_HPP
+
+#include <vector>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+#include "../boundaries/boundaries.hpp"
+#include "../obstacles/obstacles.hpp"
+#include "../threadPool/threadPool.hpp"
+#include "../snapshot/snapshot.hpp"
+
+// CPU rasteriser for machines without a display or GPU. It draws the same picture
+// as Renderer (boundary, then anti-aliased particle discs) into an RGBA8 framebuffer.
+// The image is split into horizontal strips of STRIP_ROWS rows. Particles are binned
+// into every strip they touch, and the strips are rasterised in parallel. Each strip
+// draws its particles in index order, so the output does not depend on the thread count.
+class SoftwareRenderer {
+    public:
+        static const int STRIP_ROWS = 16;
+
+        SoftwareRenderer(int width_, int height_, size_t num_threads);
+
+        // world rectangle mapped onto the image, keeping the aspect ratio; defaults to the screen
+        void setView(glm::vec2 world_min, glm::vec2 world_max);
+        void setBackground(uint32_t colour);
+        // drawn grey over the boundary every frame; nullptr to stop drawing them
+        void setObstacles(const ObstacleField* obstacles_);
+
+        void render(const ParticleSnapshot& snapshot, const Boundary* boundary, float alpha = 1.0f);
+
+        // RGBA8 pixels (R in the low byte), top row first
+        const std::vector<uint32_t>& getPixels() const;
+        int getWidth() const;
+        int getHeight() const;
+
+    private:
+        int width;
+        int height;
+        int num_strips;
+        ThreadPool thread_pool;
+        std::vector<uint32_t> pixels;
+        uint32_t background;
+        const ObstacleField* obstacles;
+
+        glm::vec2 view_origin; // world point at the image's bottom-left corner
+        float scale;           // pixels per world unit
+
+        // per-frame particles in image space and their strip bins
+        std::vector<glm::vec2> centers;
+        std::vector<float> radii;
+        std::vector<uint32_t> colours;
+        std::vector<uint32_t> strip_start;
+        std::vector<uint32_t> strip_particles;
+
+        void transformParticles(const ParticleSnapshot& snapshot, float alpha);
+        void binParticles();
+        void renderStrip(int strip, const Boundary* boundary);
+        void fillBoundary(int row_begin, int row_end, const Boundary* boundary);
+        void fillObstacles(int row_begin, int row_end);
+        void fillSpans(int row, const std::vector<glm::vec2>& spans, uint32_t colour);
+        void drawDisc(int row_begin, int row_end, size_t particle);
+};
+
+#endif
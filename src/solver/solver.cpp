@@ -1,27 +1,136 @@
 #define GLM_ENABLE_EXPERIMENTAL
 
 #include <vector>
+#include <string>
+#include <iostream>
 #include <memory>
 #include <algorithm>
 #include <thread>
-#include <unordered_map>
-#include <GLFW/glfw3.h>
-#include <GL/GL.h>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <optional>
+#include <variant>
 #include <glm/glm.hpp>
 #include <glm/gtx/norm.hpp>
 
+#include "../constants/constants.hpp"
 #include "../particle/particle.hpp"
+#include "../particleStore/particleStore.hpp"
 #include "../boundaries/boundaries.hpp"
+#include "../obstacles/obstacles.hpp"
+#include "../emitter/emitter.hpp"
+#include "../forceField/forceField.hpp"
+#include "../mortonOrder/mortonOrder.hpp"
+#include "../contactCache/contactCache.hpp"
+#include "../sleepTracker/sleepTracker.hpp"
 #include "../threadPool/threadPool.hpp"
+#include "../spatialGrid/spatialGrid.hpp"
+#include "../kernels/kernels.hpp"
+#include "../profiler/profiler.hpp"
+#include "../snapshot/snapshot.hpp"
+#include "../commandQueue/commandQueue.hpp"
+#include "../simClock/simClock.hpp"
+#include "../checkpoint/checkpoint.hpp"
+#include "../trajectory/trajectory.hpp"
 
 #include "solver.hpp"
 
+namespace {
+    const size_t MIN_CHUNK_SIZE = 256;
+    const size_t FUSED_BLOCK_SIZE = 1024; // 8 float arrays of this length fit in L1/L2
+    const int COLLISION_BLOCK_CELLS = 8;  // must be at least 3 for the colouring to be race-free
+    const int MAX_STEPS_PER_TICK = 4;
+    const auto SLEEP_MARGIN = std::chrono::milliseconds(1); // below this the update thread yields instead of sleeping
+    // steps between disorder checks, adapted to how fast the order decays
+    const uint64_t MIN_REORDER_INTERVAL = 4;
+    const uint64_t MAX_REORDER_INTERVAL = 512;
+    // Cached contacts reach this fraction of the smallest diameter past touching, and
+    // the cache is rebuilt once a particle has moved half of it.
+    const float CONTACT_SKIN = 0.1f;
+    // Share of the previous substep's separation a touching pair starts from. The
+    // separation also stopped the pair's approach, and Verlet carries that into the
+    // velocity, so reapplying much more of it pumps energy into dense piles.
+    const float WARM_START_FACTOR = 0.3f;
+    // steps between island searches while some particle is at rest
+    const uint64_t ISLAND_CHECK_INTERVAL = 8;
+    // particles this fraction of the base cell apart still hold each other up
+    const float ISLAND_MARGIN = 0.05f;
+    // the mouse pull reaches 3 per second squared per unit of distance to its edge
+    const float MOUSE_PULL_RADIUS = 120.0f;
+    const float MOUSE_PULL_STRENGTH = 3.0f * MOUSE_PULL_RADIUS;
+    // grid columns a thread takes at least when a field visits the cells under its disc
+    const size_t FIELD_MIN_COLUMNS = 8;
+
+    // half stencil: each neighbouring pair of cells is visited from exactly one side
+    const int HALF_STENCIL[4][2] = {
+        {0, 1}, {1, 0}, {1, 1}, {1, -1}
+    };
+
+    int getBlockColumns(const SpatialGrid& cells) {
+        return (cells.getWidth() + COLLISION_BLOCK_CELLS - 1) / COLLISION_BLOCK_CELLS;
+    }
+
+    int getBlockRows(const SpatialGrid& cells) {
+        return (cells.getHeight() + COLLISION_BLOCK_CELLS - 1) / COLLISION_BLOCK_CELLS;
+    }
+
+    // how a pair splits a separation by mass; a sleeping particle does not move
+    void getSeparationShares(float mass_i, float mass_j, bool asleep_i, bool asleep_j, float& share_i, float& share_j) {
+        const float mass_ratio = mass_i / (mass_i + mass_j);
+        share_i = asleep_j ? 1.0f : asleep_i ? 0.0f : 1 - mass_ratio;
+        share_j = asleep_i ? 1.0f : asleep_j ? 0.0f : mass_ratio;
+    }
+}
+
 Solver::Solver(float radius_) 
-: thread_pool(std::thread::hardware_concurrency() - 1) // subtract 1 for the update thread
+: thread_pool(std::max(1u, std::thread::hardware_concurrency()) - 1) // the update thread joins every parallel_for as well
 , update_thread_running(false)
 , radius(radius_)
-, cell_size(2 * radius_)
-{};
+, obstacle_momentum(new MomentumSlot[thread_pool.getNumThreads()])
+, contact_slots(new ContactSlot[thread_pool.getNumThreads()])
+, sleep_slots(new SleepSlot[thread_pool.getNumThreads()])
+, simd_level(detectSimdLevel())
+, profiler(thread_pool.getNumThreads())
+, object_count(0)
+, sim_clock(MAX_STEPS_PER_TICK)
+{
+    setMaxObjects(SolverConstants::MAX_OBJECTS);
+};
+
+template <typename Func>
+void Solver::execInParallel(const Func& func) {
+    // the per-particle passes leave out the sleeping particles at the end of the arrays
+    execInParallel(awake_count, MIN_CHUNK_SIZE, func);
+}
+
+template <typename Func>
+void Solver::execInParallel(size_t count, size_t min_chunk_size, const Func& func) {
+    // a few pieces per thread so stealing can even out uneven chunks
+    const size_t pieces = 4 * thread_pool.getNumThreads();
+    const size_t grain = std::max(min_chunk_size, (count + pieces - 1) / pieces);
+#if PARTICLE_PROFILING
+    thread_pool.parallel_for(0, count, grain, [this, &func](size_t start, size_t end) {
+        const auto chunk_start = Profiler::now();
+        func(start, end);
+        profiler.recordChunk(ThreadPool::getThreadIndex(), chunk_start, Profiler::now());
+    });
+#else
+    thread_pool.parallel_for(0, count, grain, func);
+#endif
+}
+
+template <typename Func>
+void Solver::visitBoundary(const Func& func) {
+    // The shape is resolved once here; func receives a typed pointer (nullptr when
+    // there is no boundary), so the kernels it launches are instantiated per shape.
+    if (bounding_area) {
+        std::visit([&func](const auto& shape) { func(&shape); }, *bounding_area);
+    }
+    else {
+        func(static_cast<const std::variant_alternative_t<0, Boundary>*>(nullptr));
+    }
+}
 
 Solver::~Solver(){
     update_thread_running = false;
@@ -30,21 +139,62 @@ Solver::~Solver(){
     }
 }
 
-Particle& Solver::addObject(glm::vec2 position){
-    Particle new_particle = Particle(position, radius);
-    return objects.emplace_back(new_particle);
+ParticleView Solver::addObject(glm::vec2 position){
+    return addObject(position, radius);
 }
 
-void Solver::renderBoundary(){
-    const int bounding_type = bounding_area->getType();
-    if (bounding_type == 1){
-        RectBoundingArea* rect_boundary = dynamic_cast<RectBoundingArea*>(bounding_area.get());
-        rect_boundary->draw();
-    }
-    else if (bounding_type == 2){
-        CircleBoundingArea* circle_boundary = dynamic_cast<CircleBoundingArea*>(bounding_area.get());
-        circle_boundary->draw(5000);
-    }
+ParticleView Solver::addObject(glm::vec2 position, float radius_){
+    ParticleView view = objects.add(Particle(position, radius_));
+    object_count.store(objects.size(), std::memory_order_relaxed);
+    return view;
+}
+
+void Solver::setMaxObjects(size_t max_objects_){
+    max_objects = std::max(max_objects_, objects.size());
+    objects.reserve(max_objects);
+    grid.reserve(max_objects);
+    morton_order.reserve(max_objects);
+    contact_cache.reserve(max_objects);
+    sleep_tracker.reserve(max_objects);
+    wake_queue.reserve(max_objects);
+    snapshots.reserve(max_objects);
+}
+
+size_t Solver::getMaxObjects() const {
+    return max_objects;
+}
+
+void Solver::removeObject(ParticleHandle handle){
+    commands.push({CommandType::Remove, glm::vec2(0.0f), glm::vec2(0.0f), handle});
+}
+
+void Solver::spawnObject(glm::vec2 position, glm::vec2 velocity){
+    spawnObject(position, velocity, radius);
+}
+
+void Solver::spawnObject(glm::vec2 position, glm::vec2 velocity, float radius_){
+    commands.push({CommandType::Spawn, position, velocity, ParticleHandle(), radius_});
+}
+
+void Solver::applyForceField(const ForceField& field){
+    commands.push({CommandType::ForceField, field.position, glm::vec2(0.0f), ParticleHandle(), 0.0f, field});
+}
+
+void Solver::mousePull(glm::vec2 position){
+    ForceField pull;
+    pull.type = ForceFieldType::Radial;
+    pull.position = position;
+    pull.radius = MOUSE_PULL_RADIUS;
+    pull.strength = MOUSE_PULL_STRENGTH;
+    applyForceField(pull);
+}
+
+const ParticleSnapshot& Solver::acquireSnapshot(){
+    return snapshots.acquire();
+}
+
+size_t Solver::getObjectCount() const {
+    return object_count.load(std::memory_order_relaxed);
 }
 
 void Solver::startUpdateThread(){
@@ -53,60 +203,504 @@ void Solver::startUpdateThread(){
 }
 
 void Solver::updateLoop(){
+    // fixed timestep: run the steps that wall-clock time says are due, then wait
+    // for the next one instead of spinning
+    sim_clock.start(sim_time);
     while (update_thread_running){
-        update();
+        const int due = sim_clock.getDueSteps(sim_time, step_dt);
+        for (int i = 0; i < due; ++i){
+            update();
+        }
+        if (due > 0){
+            continue;
+        }
+
+        const auto next_step = sim_clock.getWallTime(sim_time + step_dt);
+        if (next_step - SimClock::Clock::now() > SLEEP_MARGIN){
+            std::this_thread::sleep_until(next_step - SLEEP_MARGIN);
+        }
+        else {
+            std::this_thread::yield();
+        }
     }
 }
 
 void Solver::update() {
-    if (objects.empty()){
-        return;
+    applyCommands();
+    for (Emitter& emitter : emitters){
+        emitter.emit(*this);
+    }
+    if (step_hook){
+        step_hook(*this);
+    }
+    exertForceFields();
+    // before compaction moves the indices the last grid was built with
+    if (sleeping_count > 0){
+        wakeDisturbed();
+    }
+    // removals only ever happen here, so indices are stable for the whole step
+    const size_t removed = objects.compact();
+    object_count.store(objects.size(), std::memory_order_relaxed);
+    bool reordered = false;
+    bool partitioned = false;
+    awake_count = objects.size();
+    if (collision_mode == CollisionMode::Grid){
+        reordered = reorderIfDisordered();
+        if (isSleepEnabled()){
+            partitioned = sleep_tracker.partition(objects, awake_count);
+        }
+        assignGridLevels();
+    }
+    // cached contacts name particles by index; otherwise the first substep rebuilds
+    // them around particles added or moved since, warm started from the last step
+    const bool indices_changed = removed > 0 || reordered || partitioned;
+    if (indices_changed){
+        contact_cache.clear();
+    }
+    contact_cache.invalidate();
+    step_contact_stats = ContactStats();
+    step_contact_stats.iterations = contact_iterations;
+    sleep_displacement = sleep_speed * step_dt / substeps;
+    if (isSleepEnabled()){
+        sleep_tracker.resizePositions(awake_count);
+        execInParallel([this](size_t start, size_t end) {
+            sleep_tracker.recordPositions(objects, start, end);
+        });
+    }
+    capturePreviousPositions();
+
+    for (size_t t = 0; t < thread_pool.getNumThreads(); ++t){
+        obstacle_momentum[t].momentum = glm::vec2(0.0f);
+    }
+    if (!objects.empty()){
+        PROFILE_CODE(profiler.beginStep();)
+        {
+            PROFILE_PHASE(profiler, Phase::Step);
+            const float substep_dt = step_dt / substeps;
+
+            if (awake_count == 0) {
+                // everything sleeps, so nothing moves; the grid only has to follow the indices
+                if (indices_changed) {
+                    PROFILE_PHASE(profiler, Phase::Grid);
+                    updateGrid();
+                }
+            }
+            else if (pipeline_mode == PipelineMode::Fused) {
+                updateFused(substep_dt);
+            }
+            else {
+                updatePhased(substep_dt);
+            }
+        }
+        PROFILE_CODE(profiler.endStep();)
+    }
+
+    // Momentum is mass times per-substep displacement; dividing by the substep turns
+    // it into an impulse and by the step into the mean force. The obstacles receive
+    // the opposite of what they gave.
+    glm::vec2 momentum = glm::vec2(0.0f);
+    for (size_t t = 0; t < thread_pool.getNumThreads(); ++t){
+        momentum += obstacle_momentum[t].momentum;
+    }
+    obstacle_force = -momentum * static_cast<float>(substeps) / (step_dt * step_dt);
+    step_contact_stats.contacts = contact_cache.getContactCount();
+    contact_stats = step_contact_stats;
+    if (isSleepEnabled() && !objects.empty()){
+        updateSleep();
+    }
+
+    ++step_count;
+    sim_time += step_dt;
+    if (trajectory && step_count % trajectory->getInterval() == 0){
+        trajectory->submit(step_count, sim_time, objects);
+    }
+    publishSnapshot();
+}
+
+void Solver::attachTrajectory(std::unique_ptr<TrajectoryWriter> writer){
+    trajectory = std::move(writer);
+}
+
+std::unique_ptr<TrajectoryWriter> Solver::detachTrajectory(){
+    return std::move(trajectory);
+}
+
+bool Solver::saveCheckpoint(const std::string& path){
+    CheckpointSettings settings;
+    settings.gravity_x = gravity.x;
+    settings.gravity_y = gravity.y;
+    settings.step_dt = step_dt;
+    settings.substeps = substeps;
+    settings.bounce_coefficient = bounce_coefficient;
+    settings.solver_radius = radius;
+    settings.sim_time = sim_time;
+    settings.step_count = step_count;
+    settings.next_disorder_check = next_disorder_check;
+    settings.last_reorder_step = last_reorder_step;
+    settings.next_island_check = next_island_check;
+    return writeCheckpoint(path, objects, settings, getBoundary());
+}
+
+bool Solver::loadCheckpoint(const std::string& path){
+    CheckpointSettings settings;
+    std::optional<Boundary> boundary;
+    if (!readCheckpoint(path, objects, settings, boundary)){
+        return false;
+    }
+    if (settings.solver_radius != radius){
+        std::cerr << "Checkpoint was saved with particle radius " << settings.solver_radius
+                  << ", this solver spawns particles of radius " << radius << std::endl;
+    }
+
+    gravity = glm::vec2(settings.gravity_x, settings.gravity_y);
+    step_dt = settings.step_dt;
+    substeps = settings.substeps;
+    bounce_coefficient = settings.bounce_coefficient;
+    sim_time = settings.sim_time;
+    step_count = settings.step_count;
+    bounding_area = std::move(boundary);
+    next_disorder_check = settings.next_disorder_check;
+    last_reorder_step = settings.last_reorder_step;
+    next_island_check = settings.next_island_check;
+    // the warm start of cached contacts is not saved, so they are rebuilt from scratch
+    contact_cache.clear();
+    if (objects.size() > max_objects){
+        setMaxObjects(objects.size());
+    }
+    object_count.store(objects.size(), std::memory_order_relaxed);
+    if (isSleepEnabled()){
+        sleeping_count = std::count(objects.rest_steps.begin(), objects.rest_steps.end(), ParticleStore::ASLEEP);
+    }
+    else {
+        wakeAll();
+    }
+    // the last grid indexes particles that are gone; a fresh one lets the restored
+    // sleeping particles be woken and step hooks query free space
+    grid_object_count = 0;
+    if (collision_mode == CollisionMode::Grid && !objects.empty()){
+        assignGridLevels();
+        updateGrid();
     }
 
-    updateGrid();
-    const float substep_dt = step_dt / substeps;
+    // readers see the restored state before the next step
+    capturePreviousPositions();
+    publishSnapshot();
+    return true;
+}
 
+void Solver::applyCommands(){
+    commands.drain(drained_commands);
+    for (const SolverCommand& command : drained_commands){
+        if (command.type == CommandType::Spawn){
+            if (objects.size() < max_objects){
+                addObject(command.position, command.radius).setVelocity(command.velocity, getSubstepdt());
+            }
+        }
+        else if (command.type == CommandType::ForceField){
+            queued_fields.push_back(command.field);
+        }
+        else if (command.type == CommandType::Remove){
+            objects.markForRemoval(command.handle);
+        }
+    }
+}
+
+void Solver::capturePreviousPositions(){
+    // the back buffer stays with this thread until publish, so it can be filled in two halves
+    ParticleSnapshot& snapshot = snapshots.beginWrite();
+    const size_t count = objects.size();
+    snapshot.previous_positions.resize(count);
+    const float* xs = objects.x.data();
+    const float* ys = objects.y.data();
+    for (size_t i = 0; i < count; ++i){
+        snapshot.previous_positions[i] = glm::vec2(xs[i], ys[i]);
+    }
+}
+
+void Solver::publishSnapshot(){
+    ParticleSnapshot& snapshot = snapshots.beginWrite();
+    const size_t count = objects.size();
+    snapshot.positions.resize(count);
+    const float* xs = objects.x.data();
+    const float* ys = objects.y.data();
+    for (size_t i = 0; i < count; ++i){
+        snapshot.positions[i] = glm::vec2(xs[i], ys[i]);
+    }
+    snapshot.radii.assign(objects.radius.begin(), objects.radius.end());
+    snapshot.step = step_count;
+    snapshot.sim_time = sim_time;
+    snapshot.step_dt = step_dt;
+    snapshot.obstacle_force = obstacle_force;
+    snapshot.contact_residual = contact_stats.final_residual;
+    snapshots.publish();
+}
+
+float Solver::getInterpolationAlpha(const ParticleSnapshot& snapshot) const {
+    if (!sim_clock.isRunning() || snapshot.step_dt <= 0.0f){
+        return 1.0f;
+    }
+    // rendering runs one step behind the clock, so the current snapshot covers it
+    const double alpha = (sim_clock.now() - snapshot.sim_time) / snapshot.step_dt;
+    return static_cast<float>(std::min(1.0, std::max(0.0, alpha)));
+}
+
+void Solver::updatePhased(float substep_dt) {
     for (int i = 0; i < substeps; ++i) {
-        if (gravity.x != 0 && gravity.y != 0) {
+        PROFILE_PHASE(profiler, Phase::Substep);
+        if (hasGravity()) {
+            PROFILE_PHASE(profiler, Phase::Gravity);
             execInParallel([this](size_t start, size_t end) { applyGravity(start, end); });
         }
 
-        execInParallel([this, substep_dt](size_t start, size_t end) { updateObjects(substep_dt, start, end); });
+        {
+            PROFILE_PHASE(profiler, Phase::Integrate);
+            execInParallel([this, substep_dt](size_t start, size_t end) { updateObjects(substep_dt, start, end); });
+        }
 
-        execInParallel([this](size_t start, size_t end) { checkAllParticleCollisions(start, end); });
+        resolveCollisions();
 
         if (bounding_area) {
-            execInParallel([this](size_t start, size_t end) { applyBoundary(start, end); });
+            PROFILE_PHASE(profiler, Phase::Boundary);
+            std::visit([this](const auto& shape) {
+                execInParallel([this, &shape](size_t start, size_t end) {
+                    shape.constrain(simd_level, objects, bounce_coefficient, start, end);
+                });
+            }, *bounding_area);
+        }
+
+        if (!obstacles.empty()) {
+            PROFILE_PHASE(profiler, Phase::Obstacles);
+            execInParallel([this](size_t start, size_t end) {
+                obstacle_momentum[ThreadPool::getThreadIndex()].momentum += obstacles.constrain(objects, bounce_coefficient, start, end);
+            });
+        }
+    }
+}
+
+void Solver::updateFused(float substep_dt) {
+    // The per-particle passes of consecutive substeps are merged around the collision
+    // barrier: G+I | C | B+G+I | C | ... | C | B, where B is the boundary followed by
+    // the obstacles. Each chunk runs them block by block, so a block is loaded once
+    // and stays in cache for all the kernels. The order of operations per particle is
+    // the same as in the phased path.
+    {
+        PROFILE_PHASE(profiler, Phase::Fused);
+        execInParallel([this, substep_dt](size_t start, size_t end) {
+            fusedPass<RectBoundingArea>(substep_dt, false, nullptr, true, start, end);
+        });
+    }
+
+    for (int i = 0; i < substeps; ++i) {
+        PROFILE_PHASE(profiler, Phase::Substep);
+        resolveCollisions();
+
+        const bool integrate = i + 1 < substeps;
+        if (integrate || bounding_area || !obstacles.empty()) {
+            PROFILE_PHASE(profiler, Phase::Fused);
+            visitBoundary([this, substep_dt, integrate](const auto* boundary) {
+                execInParallel([this, substep_dt, integrate, boundary](size_t start, size_t end) {
+                    fusedPass(substep_dt, true, boundary, integrate, start, end);
+                });
+            });
         }
     }
 }
 
-void Solver::addBoundary(std::unique_ptr<BoundingArea> boundary){
+template <typename Shape>
+void Solver::fusedPass(float dt, bool constrain, const Shape* boundary, bool integrate, size_t start, size_t end) {
+    const bool gravity_on = integrate && hasGravity();
+    const bool obstacles_on = constrain && !obstacles.empty();
+    for (size_t block = start; block < end; block += FUSED_BLOCK_SIZE) {
+        const size_t block_end = std::min(end, block + FUSED_BLOCK_SIZE);
+        if (boundary) {
+            boundary->constrain(simd_level, objects, bounce_coefficient, block, block_end);
+        }
+        if (obstacles_on) {
+            obstacle_momentum[ThreadPool::getThreadIndex()].momentum += obstacles.constrain(objects, bounce_coefficient, block, block_end);
+        }
+        if (gravity_on) {
+            applyGravity(block, block_end);
+        }
+        if (integrate) {
+            updateObjects(dt, block, block_end);
+        }
+    }
+}
+
+void Solver::resolveCollisions() {
+    if (collision_mode == CollisionMode::Grid && contact_iterations > 0) {
+        resolveCachedContacts();
+    }
+    else if (collision_mode == CollisionMode::Grid) {
+        // particles move between cells every substep, so the grid is rebuilt before each pass
+        {
+            PROFILE_PHASE(profiler, Phase::Grid);
+            updateGrid();
+        }
+        PROFILE_PHASE(profiler, Phase::Collision);
+        checkGridCollisions();
+    }
+    else {
+        // reference path: serial, so it is race-free and deterministic as well
+        PROFILE_PHASE(profiler, Phase::Collision);
+        checkAllParticleCollisions(0, objects.size());
+        PROFILE_CODE(profiler.addPairs(0, objects.size() * (objects.size() - 1) / 2, 0);)
+    }
+}
+
+bool Solver::hasGravity() const {
+    return gravity.x != 0 || gravity.y != 0;
+}
+
+void Solver::addBoundary(Boundary boundary){
     bounding_area = std::move(boundary);
+    wakeAll();
+}
+
+const Boundary* Solver::getBoundary() const {
+    return bounding_area ? &*bounding_area : nullptr;
 }
 
-std::unique_ptr<BoundingArea>& Solver::getBoundary(){
-    return bounding_area;
+void Solver::setObstacles(ObstacleField field){
+    obstacles = std::move(field);
+    wakeAll();
 }
 
-std::vector<Particle>& Solver::getObjects(){
+const ObstacleField& Solver::getObstacles() const {
+    return obstacles;
+}
+
+glm::vec2 Solver::getObstacleForce() const {
+    return obstacle_force;
+}
+
+void Solver::addEmitter(const EmitterConfig& config){
+    emitters.emplace_back(config, radius);
+}
+
+void Solver::clearEmitters(){
+    emitters.clear();
+}
+
+const std::vector<Emitter>& Solver::getEmitters() const {
+    return emitters;
+}
+
+void Solver::addForceField(const ForceField& field){
+    force_fields.push_back(field);
+}
+
+void Solver::clearForceFields(){
+    force_fields.clear();
+}
+
+const std::vector<ForceField>& Solver::getForceFields() const {
+    return force_fields;
+}
+
+void Solver::setStepHook(std::function<void(Solver&)> hook){
+    step_hook = std::move(hook);
+}
+
+uint64_t Solver::getStepCount() const {
+    return step_count;
+}
+
+bool Solver::isSpaceFree(glm::vec2 position, float radius_) const {
+    const size_t count = objects.size();
+    const float* xs = objects.x.data();
+    const float* ys = objects.y.data();
+    const float* radii = objects.radius.data();
+    auto overlaps = [&](size_t i) {
+        const float dx = xs[i] - position.x;
+        const float dy = ys[i] - position.y;
+        const float reach = radius_ + radii[i];
+        return dx * dx + dy * dy < reach * reach;
+    };
+
+    size_t indexed = 0;
+    if (collision_mode == CollisionMode::Grid && grid_object_count > 0){
+        indexed = std::min(grid_object_count, count);
+        for (size_t level = 0; level < grid.getLevelCount(); ++level){
+            if (grid.getObjectCount(level) == 0){
+                continue;
+            }
+            const SpatialGrid& cells = grid.getLevel(level);
+            // with contact iterations the grid is only rebuilt once particles drift half the skin
+            const float reach = radius_ + grid.getMaxRadius(level) + grid.getSkin();
+            const int x_begin = cells.getCellX(position.x - reach);
+            const int x_end = cells.getCellX(position.x + reach);
+            const int y_begin = cells.getCellY(position.y - reach);
+            const int y_end = cells.getCellY(position.y + reach);
+            for (int x = x_begin; x <= x_end; ++x){
+                for (int y = y_begin; y <= y_end; ++y){
+                    const int cell = cells.getCellIndex(x, y);
+                    for (const uint32_t* it = cells.cellBegin(cell); it != cells.cellEnd(cell); ++it){
+                        if (*it < count && overlaps(*it)){
+                            return false;
+                        }
+                    }
+                }
+            }
+        }
+    }
+    for (size_t i = indexed; i < count; ++i){
+        if (overlaps(i)){
+            return false;
+        }
+    }
+    return true;
+}
+
+ParticleStore& Solver::getObjects(){
     return objects;
 }
 
+void Solver::setMaxStepsPerTick(int steps){
+    sim_clock.setMaxStepsPerTick(steps);
+}
+
+void Solver::setReorderThreshold(float threshold){
+    reorder_threshold = threshold;
+}
+
+void Solver::setContactIterations(int iterations){
+    contact_iterations = std::max(0, iterations);
+}
+
+ContactStats Solver::getContactStats() const {
+    return contact_stats;
+}
+
+void Solver::setSleepThreshold(float speed, int steps){
+    sleep_speed = std::max(0.0f, speed);
+    sleep_steps = static_cast<uint32_t>(std::max(1, steps));
+    wakeAll();
+}
+
+size_t Solver::getSleepingCount() const {
+    return sleeping_count;
+}
+
 float Solver::getStepdt(){
     return step_dt;
 }
 
+float Solver::getSubstepdt() const {
+    return step_dt / substeps;
+}
+
 int Solver::getSubsteps(){
     return substeps;
 }
 
-void Solver::setObjectVelocity(Particle& obj, glm::vec2 v){
-    obj.setVelocity(v, step_dt);
+void Solver::setObjectVelocity(ParticleView obj, glm::vec2 v){
+    obj.setVelocity(v, getSubstepdt());
 }
 
 void Solver::setGravity(glm::vec2 g){
     gravity = g;
+    wakeAll();
 }
 
 void Solver::setStepDt(float dt){
@@ -117,158 +711,812 @@ void Solver::setSubsteps(int substeps_){
     substeps = substeps_;
 }
 
-void Solver::mousePull(glm::vec2 pos){
-    for (auto& obj : objects){
-        glm::vec2 dir = pos - obj.position;
-        float dist = glm::length(dir);
-        glm::vec2 a = dir * std::max(0.0f, 3 * (120 - dist));
-        obj.accelerate(a);
+void Solver::setCollisionMode(CollisionMode mode){
+    collision_mode = mode;
+    grid_object_count = 0; // the last grid stops following the particles in all-pairs mode
+    wakeAll();
+}
+
+void Solver::setPipelineMode(PipelineMode mode){
+    pipeline_mode = mode;
+}
+
+void Solver::setSimdLevel(SimdLevel level){
+    simd_level = level;
+}
+
+SimdLevel Solver::getSimdLevel(){
+    return simd_level;
+}
+
+size_t Solver::getNumThreads() const {
+    return thread_pool.getNumThreads();
+}
+
+SolverStats Solver::getStats(){
+    return profiler.getStats();
+}
+
+void Solver::resetStats(){
+    profiler.reset();
+}
+
+void Solver::setTraceEnabled(bool enabled){
+    profiler.setTraceEnabled(enabled);
+}
+
+bool Solver::writeTrace(const std::string& path){
+    return profiler.writeTrace(path);
+}
+
+void Solver::exertForceFields(){
+    if (queued_fields.empty() && force_fields.empty()){
+        return;
+    }
+    PROFILE_PHASE(profiler, Phase::Fields);
+    for (const ForceField& field : queued_fields){
+        exertForceField(field);
+    }
+    queued_fields.clear();
+    for (const ForceField& field : force_fields){
+        exertForceField(field);
+    }
+}
+
+void Solver::exertForceField(const ForceField& field){
+    // Runs before compaction, while the indices of the last grid still hold. The field
+    // acts over the whole step, so its effect does not depend on the substeps. Verlet
+    // keeps the velocity as the last substep's displacement, so the change goes into
+    // the previous position; a sleeping particle it moves is woken by wakeDisturbed.
+    const size_t count = objects.size();
+    const float* xs = objects.x.data();
+    const float* ys = objects.y.data();
+    float* last_x = objects.last_x.data();
+    float* last_y = objects.last_y.data();
+    const float substep_dt = getSubstepdt();
+    auto exert = [&](size_t i) {
+        const glm::vec2 velocity = glm::vec2(xs[i] - last_x[i], ys[i] - last_y[i]) / substep_dt;
+        const glm::vec2 change = field.getVelocityChange(glm::vec2(xs[i], ys[i]), velocity, step_dt);
+        last_x[i] -= change.x * substep_dt;
+        last_y[i] -= change.y * substep_dt;
+    };
+
+    size_t indexed = 0;
+    if (field.isBounded() && collision_mode == CollisionMode::Grid && grid_object_count > 0){
+        indexed = std::min(grid_object_count, count);
+        for (size_t level = 0; level < grid.getLevelCount(); ++level){
+            if (grid.getObjectCount(level) == 0){
+                continue;
+            }
+            const SpatialGrid& cells = grid.getLevel(level);
+            // a particle sits in one cell, so the columns can be split between threads
+            const float reach = field.radius + grid.getMaxRadius(level) + grid.getSkin();
+            const int x_begin = cells.getCellX(field.position.x - reach);
+            const int x_end = cells.getCellX(field.position.x + reach);
+            const int y_begin = cells.getCellY(field.position.y - reach);
+            const int y_end = cells.getCellY(field.position.y + reach);
+            execInParallel(x_end - x_begin + 1, FIELD_MIN_COLUMNS, [&](size_t start, size_t end) {
+                for (int x = x_begin + static_cast<int>(start); x < x_begin + static_cast<int>(end); ++x){
+                    for (int y = y_begin; y <= y_end; ++y){
+                        const int cell = cells.getCellIndex(x, y);
+                        for (const uint32_t* it = cells.cellBegin(cell); it != cells.cellEnd(cell); ++it){
+                            if (*it < indexed){
+                                exert(*it);
+                            }
+                        }
+                    }
+                }
+            });
+        }
     }
+    // unbounded fields, all-pairs mode and the particles added since the grid was built
+    execInParallel(count - indexed, MIN_CHUNK_SIZE, [&](size_t start, size_t end) {
+        for (size_t i = indexed + start; i < indexed + end; ++i){
+            exert(i);
+        }
+    });
 }
 
 void Solver::applyGravity(size_t start, size_t end) {
+    float* __restrict acc_x = objects.acc_x.data();
+    float* __restrict acc_y = objects.acc_y.data();
+    const float gx = gravity.x;
+    const float gy = gravity.y;
+
     for (size_t i = start; i < end; ++i) {
-        objects[i].accelerate(gravity);
+        acc_x[i] += gx;
+        acc_y[i] += gy;
     }
 }
 
-void Solver::applyBoundary(size_t start, size_t end) {
-    const int boundary_type = bounding_area->getType();
-    
-    for (size_t i = start; i < end; ++i) {
-        auto& obj = objects[i];
-        glm::vec2 velocity = obj.getVelocity(); 
-        
-        if(boundary_type == 1){
-            RectBoundingArea* rect_boundary = dynamic_cast<RectBoundingArea*>(bounding_area.get());
-
-            if (obj.position.y - obj.radius <= rect_boundary->top_line){
-                obj.position.y = rect_boundary->top_line + obj.radius;
-                velocity.y *= -bounce_coefficient; 
-                obj.setVelocity(velocity, 1.0f);
+void Solver::updateObjects(float dt, size_t start, size_t end) {
+    integrateKernel(simd_level, objects, dt, start, end);
+}
+
+void Solver::getDomainBounds(glm::vec2& min_corner, glm::vec2& max_corner) const {
+    min_corner = glm::vec2({0.0f, 0.0f});
+    max_corner = glm::vec2({GraphicsConstants::SCREEN_WIDTH, GraphicsConstants::SCREEN_HEIGHT});
+    if (bounding_area) {
+        getBoundaryBounds(*bounding_area, min_corner, max_corner);
+    }
+}
+
+bool Solver::reorderIfDisordered() {
+    if (reorder_threshold <= 0.0f || step_count < next_disorder_check) {
+        return false;
+    }
+    PROFILE_PHASE(profiler, Phase::Reorder);
+    glm::vec2 min_corner, max_corner;
+    getDomainBounds(min_corner, max_corner);
+    // the base cell size of the last assignment; the order only has to be close
+    morton_order.computeKeys(objects, min_corner, grid.getBaseCellSize());
+    const float disorder = morton_order.measureDisorder();
+    const bool reordered = disorder > reorder_threshold;
+    if (reordered) {
+        objects.permute(morton_order.sort());
+    }
+
+    // Disorder builds up roughly linearly after a sort, so its rate since the last one
+    // predicts when the threshold will be crossed next.
+    const uint64_t steps_since = std::max<uint64_t>(step_count - last_reorder_step, 1);
+    const float rate = disorder / steps_since;
+    const float remaining = reordered ? reorder_threshold : reorder_threshold - disorder;
+    uint64_t interval = MAX_REORDER_INTERVAL;
+    if (rate > 0.0f) {
+        interval = static_cast<uint64_t>(std::min(remaining / rate, static_cast<float>(MAX_REORDER_INTERVAL)));
+    }
+    next_disorder_check = step_count + std::max(interval, MIN_REORDER_INTERVAL);
+    if (reordered) {
+        last_reorder_step = step_count;
+    }
+    PROFILE_CODE(profiler.recordReorder(disorder, reordered);)
+    return reordered;
+}
+
+void Solver::assignGridLevels() {
+    glm::vec2 min_corner, max_corner;
+    getDomainBounds(min_corner, max_corner);
+    grid.assignLevels(objects, min_corner, max_corner, contact_iterations > 0 ? CONTACT_SKIN : 0.0f);
+}
+
+void Solver::updateGrid() {
+    glm::vec2 min_corner, max_corner;
+    getDomainBounds(min_corner, max_corner);
+    grid.configure(min_corner, max_corner);
+    grid.build(objects, thread_pool);
+    grid_object_count = objects.size();
+    PROFILE_CODE(profiler.setGridStats(grid.computeStats());)
+}
+
+template <typename Func>
+void Solver::forEachNeighbourPair(const SpatialGrid& cells, int x, int y, const Func& func) const {
+    const int cell = cells.getCellIndex(x, y);
+    const uint32_t* begin = cells.cellBegin(cell);
+    const uint32_t* end = cells.cellEnd(cell);
+    if (begin == end){
+        return;
+    }
+
+    // cells list their particles by index and the sleeping ones come last, so a cell
+    // whose first particle sleeps has no awake one, and its pairs with a cell like
+    // it can be skipped
+    const bool asleep = *begin >= awake_count;
+    if (!asleep){
+        for (const uint32_t* i = begin; i != end; ++i){
+            for (const uint32_t* j = i + 1; j != end; ++j){
+                func(*i, *j);
             }
-            if (obj.position.y + obj.radius > rect_boundary->bottom_line){
-                obj.position.y = rect_boundary->bottom_line - obj.radius;
-                velocity.y *= -bounce_coefficient; 
-                obj.setVelocity(velocity, 1.0f);
+        }
+    }
+
+    for (const auto& offset : HALF_STENCIL) {
+        const int nx = x + offset[0];
+        const int ny = y + offset[1];
+        if (nx < cells.getWidth() && ny >= 0 && ny < cells.getHeight()){
+            const int other_cell = cells.getCellIndex(nx, ny);
+            const uint32_t* other_begin = cells.cellBegin(other_cell);
+            const uint32_t* other_end = cells.cellEnd(other_cell);
+            if (asleep && (other_begin == other_end || *other_begin >= awake_count)){
+                continue;
             }
-            if (obj.position.x - obj.radius < rect_boundary->left_side){
-                obj.position.x = rect_boundary->left_side + obj.radius;
-                velocity.x *= -bounce_coefficient;
-                obj.setVelocity(velocity, 1.0f);
+            for (const uint32_t* i = begin; i != end; ++i){
+                for (const uint32_t* j = other_begin; j != other_end; ++j){
+                    func(*i, *j);
+                }
             }
-            if (obj.position.x + obj.radius > rect_boundary->right_side){
-                obj.position.x = rect_boundary->right_side - obj.radius;
-                velocity.x *= -bounce_coefficient;
-                obj.setVelocity(velocity, 1.0f);
+        }
+    }
+}
+
+size_t Solver::checkNeighbouringCells(const SpatialGrid& cells, int x, int y){
+    size_t contacts = 0;
+    forEachNeighbourPair(cells, x, y, [this, &contacts](uint32_t i, uint32_t j) {
+        contacts += checkOneParticleCollision(i, j);
+    });
+    return contacts;
+}
+
+size_t Solver::countPairTests(const SpatialGrid& cells, int x, int y) const {
+    const int cell = cells.getCellIndex(x, y);
+    const size_t count = cells.cellEnd(cell) - cells.cellBegin(cell);
+    size_t tests = count * (count - (count > 0)) / 2;
+    for (const auto& offset : HALF_STENCIL) {
+        const int nx = x + offset[0];
+        const int ny = y + offset[1];
+        if (nx < cells.getWidth() && ny >= 0 && ny < cells.getHeight()){
+            const int other_cell = cells.getCellIndex(nx, ny);
+            tests += count * (cells.cellEnd(other_cell) - cells.cellBegin(other_cell));
+        }
+    }
+    return tests;
+}
+
+void Solver::checkGridCollisions(){
+    // pairs on the same level first, level by level
+    for (size_t level = 0; level < grid.getLevelCount(); ++level){
+        if (grid.getObjectCount(level) == 0){
+            continue;
+        }
+        const SpatialGrid& cells = grid.getLevel(level);
+        forEachColouredBlock(cells, [this, &cells](int block_x, int block_y) {
+            checkCellBlock(cells, block_x, block_y);
+        });
+    }
+    // then every larger particle against the finer levels around it
+    for (size_t level = 1; level < grid.getLevelCount(); ++level){
+        if (grid.getObjectCount(level) == 0){
+            continue;
+        }
+        forEachColouredBlock(grid.getLevel(level), [this, level](int block_x, int block_y) {
+            checkCrossLevelBlock(level, block_x, block_y);
+        });
+    }
+}
+
+template <typename Func>
+void Solver::forEachColouredBlock(const SpatialGrid& cells, const Func& func){
+    // The grid is cut into fixed blocks of COLLISION_BLOCK_CELLS^2 cells, coloured as a
+    // 2x2 checkerboard. A block only writes to its own cells plus one column to the right
+    // and one row above and below, so blocks of the same colour never share a particle and
+    // each colour runs in parallel without locks. The blocks do not depend on the number
+    // of threads, so the result is bit-identical for any hardware_concurrency().
+    const int blocks_x = getBlockColumns(cells);
+    const int blocks_y = getBlockRows(cells);
+
+    for (int colour = 0; colour < 4; ++colour){
+        const int offset_x = colour & 1;
+        const int offset_y = colour >> 1;
+        const int colour_blocks_x = (blocks_x - offset_x + 1) / 2;
+        const int colour_blocks_y = (blocks_y - offset_y + 1) / 2;
+
+        const size_t count = static_cast<size_t>(colour_blocks_x) * colour_blocks_y;
+        execInParallel(count, 1, [&func, offset_x, offset_y, colour_blocks_x](size_t start, size_t end) {
+            for (size_t b = start; b < end; ++b){
+                const int block_x = 2 * static_cast<int>(b % colour_blocks_x) + offset_x;
+                const int block_y = 2 * static_cast<int>(b / colour_blocks_x) + offset_y;
+                func(block_x, block_y);
             }
+        });
+    }
+}
+
+void Solver::checkCellBlock(const SpatialGrid& cells, int block_x, int block_y){
+    const int start_x = block_x * COLLISION_BLOCK_CELLS;
+    const int start_y = block_y * COLLISION_BLOCK_CELLS;
+    const int end_x = std::min(start_x + COLLISION_BLOCK_CELLS, cells.getWidth());
+    const int end_y = std::min(start_y + COLLISION_BLOCK_CELLS, cells.getHeight());
+
+    size_t contacts = 0;
+    for (int x = start_x; x < end_x; ++x){
+        for (int y = start_y; y < end_y; ++y){
+            contacts += checkNeighbouringCells(cells, x, y);
         }
-        else if (boundary_type == 2) {
-            CircleBoundingArea* circle_boundary = dynamic_cast<CircleBoundingArea*>(bounding_area.get());
-        
-            glm::vec2 to_particle = obj.position - circle_boundary->center;
-            float dist_from_center = glm::length(to_particle);
-        
-            if (dist_from_center > circle_boundary->radius - obj.radius) {
-                glm::vec2 normal = to_particle / dist_from_center;
-                glm::vec2 velocity = obj.getVelocity();
-        
-                float velocity_normal = glm::dot(velocity, normal);
-        
-                if (velocity_normal > 0) {
-                    velocity -= (1.0f + bounce_coefficient) * velocity_normal * normal;
+    }
+
+#if PARTICLE_PROFILING
+    size_t tests = 0;
+    for (int x = start_x; x < end_x; ++x){
+        for (int y = start_y; y < end_y; ++y){
+            tests += countPairTests(cells, x, y);
+        }
+    }
+    profiler.addPairs(ThreadPool::getThreadIndex(), tests, contacts);
+#endif
+}
+
+template <typename Func>
+void Solver::forEachCrossLevelPair(size_t level, int x, int y, float margin, const Func& func) const {
+    const SpatialGrid& coarse = grid.getLevel(level);
+    const float* xs = objects.x.data();
+    const float* ys = objects.y.data();
+    const int cell = coarse.getCellIndex(x, y);
+    for (const uint32_t* j = coarse.cellBegin(cell); j != coarse.cellEnd(cell); ++j){
+        for (size_t finer = 0; finer < level; ++finer){
+            if (grid.getObjectCount(finer) == 0){
+                continue;
+            }
+            const SpatialGrid& cells = grid.getLevel(finer);
+            const float reach = objects.radius[*j] + grid.getMaxRadius(finer) + margin;
+            const int x_begin = cells.getCellX(xs[*j] - reach);
+            const int x_end = cells.getCellX(xs[*j] + reach);
+            const int y_begin = cells.getCellY(ys[*j] - reach);
+            const int y_end = cells.getCellY(ys[*j] + reach);
+            for (int fx = x_begin; fx <= x_end; ++fx){
+                for (int fy = y_begin; fy <= y_end; ++fy){
+                    const int fine_cell = cells.getCellIndex(fx, fy);
+                    if (*j >= awake_count && (cells.cellBegin(fine_cell) == cells.cellEnd(fine_cell) || *cells.cellBegin(fine_cell) >= awake_count)){
+                        continue;
+                    }
+                    for (const uint32_t* i = cells.cellBegin(fine_cell); i != cells.cellEnd(fine_cell); ++i){
+                        func(*j, *i);
+                    }
                 }
-        
-                obj.position = circle_boundary->center + normal * (circle_boundary->radius - obj.radius);
-                obj.setVelocity(velocity, 1.0f);
             }
         }
     }
 }
 
-void Solver::updateObjects(float dt, size_t start, size_t end) {
-    for (size_t i = start; i < end; ++i) {
-        objects[i].updatePos(dt);
+void Solver::checkCrossLevelBlock(size_t level, int block_x, int block_y){
+    // A particle on this level is at most half a cell wide and the finer ones at most a
+    // quarter, so a contact never reaches past the neighbouring cells of this level and
+    // the colouring holds for the finer particles as well.
+    const SpatialGrid& coarse = grid.getLevel(level);
+    const int start_x = block_x * COLLISION_BLOCK_CELLS;
+    const int start_y = block_y * COLLISION_BLOCK_CELLS;
+    const int end_x = std::min(start_x + COLLISION_BLOCK_CELLS, coarse.getWidth());
+    const int end_y = std::min(start_y + COLLISION_BLOCK_CELLS, coarse.getHeight());
+
+    size_t contacts = 0;
+    PROFILE_CODE(size_t tests = 0;)
+    for (int x = start_x; x < end_x; ++x){
+        for (int y = start_y; y < end_y; ++y){
+            forEachCrossLevelPair(level, x, y, 0.0f, [&](uint32_t j, uint32_t i) {
+                contacts += checkOneParticleCollision(j, i);
+                PROFILE_CODE(++tests;)
+            });
+        }
     }
+    PROFILE_CODE(profiler.addPairs(ThreadPool::getThreadIndex(), tests, contacts);)
 }
 
-void Solver::execInParallel(std::function<void(size_t, size_t)> func) {
-    const size_t num_threads = thread_pool.getNumThreads();
-    const size_t num_objects = objects.size();
-    const size_t min_chunk_size = 50;
-    const size_t chunk_size = (num_objects + num_threads - 1) / num_threads; // Ensure at least one object per chunk
+void Solver::resolveCachedContacts(){
+    if (needsContactRebuild()){
+        {
+            PROFILE_PHASE(profiler, Phase::Grid);
+            updateGrid();
+        }
+        PROFILE_PHASE(profiler, Phase::Contacts);
+        buildContacts();
+        ++step_contact_stats.rebuilds;
+    }
 
-    if (chunk_size < min_chunk_size) {
-        // If chunk size is less than 50, process all objects on a single thread
-        thread_pool.enqueue([this, func, num_objects] { func(0, num_objects); });
+    PROFILE_PHASE(profiler, Phase::Collision);
+    forEachContactBlock([this](std::vector<Contact>& contacts) {
+        warmStartContacts(contacts);
+    });
+    for (int iteration = 0; iteration < contact_iterations; ++iteration){
+        for (size_t t = 0; t < thread_pool.getNumThreads(); ++t){
+            contact_slots[t].overlap = 0.0f;
+        }
+        forEachContactBlock([this](std::vector<Contact>& contacts) {
+            ContactSlot& slot = contact_slots[ThreadPool::getThreadIndex()];
+            slot.overlap = std::max(slot.overlap, relaxContacts(contacts));
+        });
+
+        float overlap = 0.0f;
+        for (size_t t = 0; t < thread_pool.getNumThreads(); ++t){
+            overlap = std::max(overlap, contact_slots[t].overlap);
+        }
+        if (iteration == 0){
+            step_contact_stats.initial_residual = std::max(step_contact_stats.initial_residual, overlap);
+        }
+        if (iteration + 1 == contact_iterations){
+            step_contact_stats.final_residual = std::max(step_contact_stats.final_residual, overlap);
+        }
     }
-    else
-    {
-        for (size_t t = 0; t < num_threads; ++t) {
-            size_t start = t * chunk_size;
-            size_t end = (t == num_threads - 1) ? objects.size() : (t + 1) * chunk_size;
-            thread_pool.enqueue([this, func, start, end] { func(start, end); });
+}
+
+bool Solver::needsContactRebuild(){
+    if (!contact_cache.isBuilt()){
+        return true;
+    }
+    PROFILE_PHASE(profiler, Phase::Contacts);
+    for (size_t t = 0; t < thread_pool.getNumThreads(); ++t){
+        contact_slots[t].displacement2 = 0.0f;
+    }
+    execInParallel([this](size_t start, size_t end) {
+        ContactSlot& slot = contact_slots[ThreadPool::getThreadIndex()];
+        slot.displacement2 = std::max(slot.displacement2, contact_cache.getMaxDisplacement2(objects, start, end));
+    });
+
+    // two particles that each moved less than half the skin cannot have closed a gap wider than it
+    float displacement2 = 0.0f;
+    for (size_t t = 0; t < thread_pool.getNumThreads(); ++t){
+        displacement2 = std::max(displacement2, contact_slots[t].displacement2);
+    }
+    const float limit = 0.5f * grid.getSkin();
+    return displacement2 > limit * limit;
+}
+
+void Solver::buildContacts(){
+    // Blocks are numbered row by row within each pass, so a block built here is found
+    // again from its coordinates by forEachContactBlock.
+    contact_cache.beginBuild();
+    for (size_t level = 0; level < grid.getLevelCount(); ++level){
+        if (grid.getObjectCount(level) == 0){
+            continue;
+        }
+        const SpatialGrid& cells = grid.getLevel(level);
+        const size_t blocks_x = getBlockColumns(cells);
+        const size_t block_count = blocks_x * getBlockRows(cells);
+        const size_t first_block = contact_cache.addPass(level, false, block_count);
+        execInParallel(block_count, 1, [this, &cells, blocks_x, first_block](size_t start, size_t end) {
+            for (size_t b = start; b < end; ++b){
+                buildContactBlock(cells, b % blocks_x, b / blocks_x, contact_cache.getBlock(first_block + b));
+            }
+        });
+    }
+    for (size_t level = 1; level < grid.getLevelCount(); ++level){
+        if (grid.getObjectCount(level) == 0){
+            continue;
+        }
+        const SpatialGrid& cells = grid.getLevel(level);
+        const size_t blocks_x = getBlockColumns(cells);
+        const size_t block_count = blocks_x * getBlockRows(cells);
+        const size_t first_block = contact_cache.addPass(level, true, block_count);
+        execInParallel(block_count, 1, [this, level, blocks_x, first_block](size_t start, size_t end) {
+            for (size_t b = start; b < end; ++b){
+                buildCrossLevelContactBlock(level, b % blocks_x, b / blocks_x, contact_cache.getBlock(first_block + b));
+            }
+        });
+    }
+    contact_cache.endBuild();
+
+    contact_cache.resizePositions(objects.size());
+    execInParallel([this](size_t start, size_t end) {
+        contact_cache.recordPositions(objects, start, end);
+    });
+}
+
+void Solver::buildContactBlock(const SpatialGrid& cells, int block_x, int block_y, std::vector<Contact>& contacts){
+    const int start_x = block_x * COLLISION_BLOCK_CELLS;
+    const int start_y = block_y * COLLISION_BLOCK_CELLS;
+    const int end_x = std::min(start_x + COLLISION_BLOCK_CELLS, cells.getWidth());
+    const int end_y = std::min(start_y + COLLISION_BLOCK_CELLS, cells.getHeight());
+    const float* xs = objects.x.data();
+    const float* ys = objects.y.data();
+    const float* radii = objects.radius.data();
+    const float skin = grid.getSkin();
+
+    PROFILE_CODE(size_t tests = 0;)
+    for (int x = start_x; x < end_x; ++x){
+        for (int y = start_y; y < end_y; ++y){
+            forEachNeighbourPair(cells, x, y, [&](uint32_t i, uint32_t j) {
+                PROFILE_CODE(++tests;)
+                if (i >= awake_count && j >= awake_count){
+                    return;
+                }
+                const float dx = xs[i] - xs[j];
+                const float dy = ys[i] - ys[j];
+                const float reach = radii[i] + radii[j] + skin;
+                if (dx * dx + dy * dy < reach * reach){
+                    contacts.push_back({i, j, contact_cache.findLambda(i, j)});
+                }
+            });
         }
     }
-    
-    thread_pool.wait_for_tasks();
+    PROFILE_CODE(profiler.addPairs(ThreadPool::getThreadIndex(), tests, contacts.size());)
 }
 
-void Solver::updateGrid() {
-    cell_map.clear();
-    for (auto& obj: objects){
-        auto cell = getCell(obj.position);
-        cell_map[cell].push_back(&obj);
+void Solver::buildCrossLevelContactBlock(size_t level, int block_x, int block_y, std::vector<Contact>& contacts){
+    // the skin is part of every cell, so the colouring argument of checkCrossLevelBlock holds
+    const SpatialGrid& coarse = grid.getLevel(level);
+    const int start_x = block_x * COLLISION_BLOCK_CELLS;
+    const int start_y = block_y * COLLISION_BLOCK_CELLS;
+    const int end_x = std::min(start_x + COLLISION_BLOCK_CELLS, coarse.getWidth());
+    const int end_y = std::min(start_y + COLLISION_BLOCK_CELLS, coarse.getHeight());
+    const float* xs = objects.x.data();
+    const float* ys = objects.y.data();
+    const float* radii = objects.radius.data();
+    const float skin = grid.getSkin();
+
+    PROFILE_CODE(size_t tests = 0;)
+    for (int x = start_x; x < end_x; ++x){
+        for (int y = start_y; y < end_y; ++y){
+            forEachCrossLevelPair(level, x, y, skin, [&](uint32_t j, uint32_t i) {
+                PROFILE_CODE(++tests;)
+                if (i >= awake_count && j >= awake_count){
+                    return;
+                }
+                const float dx = xs[j] - xs[i];
+                const float dy = ys[j] - ys[i];
+                const float reach = radii[i] + radii[j] + skin;
+                if (dx * dx + dy * dy < reach * reach){
+                    contacts.push_back({j, i, contact_cache.findLambda(j, i)});
+                }
+            });
+        }
     }
+    PROFILE_CODE(profiler.addPairs(ThreadPool::getThreadIndex(), tests, contacts.size());)
 }
 
-std::pair<int, int> Solver::getCell(const glm::vec2& pos) const {
-    int x = static_cast<int>(pos.x / cell_size);
-    int y = static_cast<int>(pos.y / cell_size);
-    return {x, y};
+template <typename Func>
+void Solver::forEachContactBlock(const Func& func){
+    // same passes and colours as the one-shot path, so the blocks of a colour never
+    // share a particle
+    for (const ContactCache::Pass& pass : contact_cache.getPasses()){
+        const SpatialGrid& cells = grid.getLevel(pass.level);
+        const int blocks_x = getBlockColumns(cells);
+        forEachColouredBlock(cells, [this, &func, &pass, blocks_x](int block_x, int block_y) {
+            func(contact_cache.getBlock(pass.first_block + static_cast<size_t>(block_y) * blocks_x + block_x));
+        });
+    }
 }
 
-void Solver::checkNeighbouringCells(const std::pair<int, int>& cell){
-    static const std::vector<std::pair<int, int>> neighbours = {
-        {0, 1}, {1, 0}, {1, 1}, {1, -1}
+void Solver::warmStartContacts(std::vector<Contact>& contacts){
+    float* __restrict xs = objects.x.data();
+    float* __restrict ys = objects.y.data();
+    const float* radii = objects.radius.data();
+    const float* masses = objects.mass.data();
+    for (Contact& contact : contacts){
+        if (contact.lambda <= 0.0f){
+            continue;
+        }
+        const uint32_t i = contact.i;
+        const uint32_t j = contact.j;
+        const float dx = xs[i] - xs[j];
+        const float dy = ys[i] - ys[j];
+        const float dist2 = dx * dx + dy * dy;
+        const float min_dist = radii[i] + radii[j];
+        // pairs that came apart keep no separation to carry over
+        if (dist2 >= min_dist * min_dist){
+            contact.lambda = 0.0f;
+            continue;
+        }
+        const float dist = std::sqrt(dist2);
+        const float nx = dist > 0.0f ? dx / dist : 1.0f;
+        const float ny = dist > 0.0f ? dy / dist : 0.0f;
+        float share_i, share_j;
+        getSeparationShares(masses[i], masses[j], i >= awake_count, j >= awake_count, share_i, share_j);
+
+        contact.lambda *= WARM_START_FACTOR;
+        xs[i] += nx * share_i * contact.lambda;
+        ys[i] += ny * share_i * contact.lambda;
+        xs[j] -= nx * share_j * contact.lambda;
+        ys[j] -= ny * share_j * contact.lambda;
+    }
+}
+
+float Solver::relaxContacts(std::vector<Contact>& contacts){
+    float* __restrict xs = objects.x.data();
+    float* __restrict ys = objects.y.data();
+    const float* radii = objects.radius.data();
+    const float* masses = objects.mass.data();
+    float max_overlap = 0.0f;
+    for (Contact& contact : contacts){
+        const uint32_t i = contact.i;
+        const uint32_t j = contact.j;
+        const float dx = xs[i] - xs[j];
+        const float dy = ys[i] - ys[j];
+        const float dist2 = dx * dx + dy * dy;
+        const float min_dist = radii[i] + radii[j];
+        if (contact.lambda <= 0.0f && dist2 >= min_dist * min_dist){
+            continue;
+        }
+
+        // The separation over the substep is clamped at zero rather than each
+        // correction, so a pair pushed too far by the warm start or an earlier
+        // iteration is pulled back, but never together.
+        const float dist = std::sqrt(dist2);
+        const float overlap = min_dist - dist;
+        max_overlap = std::max(max_overlap, overlap);
+        const float delta = std::max(overlap, -contact.lambda);
+        contact.lambda += delta;
+
+        const float nx = dist > 0.0f ? dx / dist : 1.0f;
+        const float ny = dist > 0.0f ? dy / dist : 0.0f;
+        const bool asleep_i = i >= awake_count;
+        const bool asleep_j = j >= awake_count;
+        float share_i, share_j;
+        getSeparationShares(masses[i], masses[j], asleep_i, asleep_j, share_i, share_j);
+        xs[i] += nx * share_i * delta;
+        ys[i] += ny * share_i * delta;
+        xs[j] -= nx * share_j * delta;
+        ys[j] -= ny * share_j * delta;
+        if ((asleep_i || asleep_j) && overlap > sleep_displacement){
+            sleep_slots[ThreadPool::getThreadIndex()].woken.push_back(asleep_i ? i : j);
+        }
+    }
+    return max_overlap;
+}
+
+bool Solver::isSleepEnabled() const {
+    return sleep_speed > 0.0f && collision_mode == CollisionMode::Grid;
+}
+
+void Solver::wakeAll(){
+    std::fill(objects.rest_steps.begin(), objects.rest_steps.end(), 0u);
+    sleeping_count = 0;
+}
+
+void Solver::wakeDisturbed(){
+    // A particle was put to sleep exactly at rest, so a sleeping particle that moved or
+    // was accelerated since (the mouse pull, a step hook) has been disturbed. A removed
+    // one stops holding up its neighbours.
+    const size_t count = std::min(objects.size(), grid_object_count);
+    const uint32_t* rest_steps = objects.rest_steps.data();
+    wake_queue.clear();
+    for (size_t i = 0; i < count; ++i){
+        if (rest_steps[i] == ParticleStore::ASLEEP
+            && (objects.x[i] != objects.last_x[i] || objects.y[i] != objects.last_y[i]
+                || objects.acc_x[i] != 0.0f || objects.acc_y[i] != 0.0f)){
+            wake_queue.push_back(static_cast<uint32_t>(i));
+        }
+    }
+    for (const ParticleHandle& handle : objects.getPendingRemovals()){
+        if (objects.contains(handle) && objects.indexOf(handle) < count){
+            wake_queue.push_back(static_cast<uint32_t>(objects.indexOf(handle)));
+        }
+    }
+    if (!wake_queue.empty()){
+        sleeping_count -= wakeIslands();
+    }
+}
+
+size_t Solver::wakeIslands(){
+    // Breadth first from the particles in wake_queue through every sleeping particle
+    // touching a woken one, on the last grid. A particle can be queued more than once;
+    // only its first visit wakes it.
+    uint32_t* rest_steps = objects.rest_steps.data();
+    const float* xs = objects.x.data();
+    const float* ys = objects.y.data();
+    const float* radii = objects.radius.data();
+    const size_t count = std::min(objects.size(), grid_object_count);
+    const float margin = ISLAND_MARGIN * grid.getBaseCellSize();
+    size_t woken = 0;
+    for (size_t next = 0; next < wake_queue.size(); ++next){
+        const uint32_t p = wake_queue[next];
+        if (rest_steps[p] != ParticleStore::ASLEEP){
+            continue;
+        }
+        rest_steps[p] = 0;
+        ++woken;
+
+        for (size_t level = 0; level < grid.getLevelCount(); ++level){
+            if (grid.getObjectCount(level) == 0){
+                continue;
+            }
+            const SpatialGrid& cells = grid.getLevel(level);
+            const float reach = radii[p] + grid.getMaxRadius(level) + grid.getSkin() + margin;
+            const int x_begin = cells.getCellX(xs[p] - reach);
+            const int x_end = cells.getCellX(xs[p] + reach);
+            const int y_begin = cells.getCellY(ys[p] - reach);
+            const int y_end = cells.getCellY(ys[p] + reach);
+            for (int x = x_begin; x <= x_end; ++x){
+                for (int y = y_begin; y <= y_end; ++y){
+                    const int cell = cells.getCellIndex(x, y);
+                    for (const uint32_t* q = cells.cellBegin(cell); q != cells.cellEnd(cell); ++q){
+                        if (*q >= count || rest_steps[*q] != ParticleStore::ASLEEP){
+                            continue;
+                        }
+                        const float dx = xs[*q] - xs[p];
+                        const float dy = ys[*q] - ys[p];
+                        const float touch = radii[p] + radii[*q] + margin;
+                        if (dx * dx + dy * dy < touch * touch){
+                            wake_queue.push_back(*q);
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return woken;
+}
+
+void Solver::updateSleep(){
+    PROFILE_PHASE(profiler, Phase::Sleep);
+    // impacts of the step first, while the grid still matches the indices
+    wake_queue.clear();
+    for (size_t t = 0; t < thread_pool.getNumThreads(); ++t){
+        std::vector<uint32_t>& woken = sleep_slots[t].woken;
+        wake_queue.insert(wake_queue.end(), woken.begin(), woken.end());
+        woken.clear();
+        sleep_slots[t].resting = 0;
+    }
+    const size_t woken = wake_queue.empty() ? 0 : wakeIslands();
+
+    execInParallel([this](size_t start, size_t end) {
+        sleep_slots[ThreadPool::getThreadIndex()].resting += sleep_tracker.countRestSteps(objects, sleep_speed * step_dt, sleep_steps, start, end);
+    });
+    size_t resting = 0;
+    for (size_t t = 0; t < thread_pool.getNumThreads(); ++t){
+        resting += sleep_slots[t].resting;
+    }
+
+    size_t slept = 0;
+    if (resting > 0 && step_count >= next_island_check){
+        next_island_check = step_count + ISLAND_CHECK_INTERVAL;
+        findIslands();
+        slept = sleep_tracker.sleepIslands(objects, sleep_steps);
+    }
+    sleeping_count = objects.size() - awake_count - woken + slept;
+}
+
+void Solver::findIslands(){
+    // Serial over the grid of the last step. Only awake pairs join islands: an island
+    // resting on a sleeping one can fall asleep on its own, and waking walks through
+    // every touching sleeping particle anyway.
+    const float* xs = objects.x.data();
+    const float* ys = objects.y.data();
+    const float* radii = objects.radius.data();
+    const float margin = ISLAND_MARGIN * grid.getBaseCellSize();
+    auto join = [&](uint32_t i, uint32_t j) {
+        if (i >= awake_count || j >= awake_count){
+            return;
+        }
+        const float dx = xs[i] - xs[j];
+        const float dy = ys[i] - ys[j];
+        const float touch = radii[i] + radii[j] + margin;
+        if (dx * dx + dy * dy < touch * touch){
+            sleep_tracker.unite(i, j);
+        }
     };
-    const auto& particles = cell_map[cell];
-    for (const auto& offset : neighbours) {
-        std::pair<int, int> neighbour_cell = {cell.first + offset.first, cell.second + offset.second};
-        if (cell_map.find(neighbour_cell) != cell_map.end()){
-            const auto& neighbour_particles = cell_map[neighbour_cell];
-            for (auto& obj : particles){
-                for (auto& other : neighbour_particles){
-                    checkOneParticleCollision(*obj, *other);
+
+    sleep_tracker.beginIslands(awake_count);
+    for (size_t level = 0; level < grid.getLevelCount(); ++level){
+        if (grid.getObjectCount(level) == 0){
+            continue;
+        }
+        const SpatialGrid& cells = grid.getLevel(level);
+        for (int x = 0; x < cells.getWidth(); ++x){
+            for (int y = 0; y < cells.getHeight(); ++y){
+                forEachNeighbourPair(cells, x, y, join);
+                if (level > 0){
+                    forEachCrossLevelPair(level, x, y, margin, join);
                 }
             }
         }
     }
 }
 
-void Solver::checkOneParticleCollision(Particle& obj, Particle& other){
-    const glm::vec2 d_vec = obj.position - other.position;
-    const float dist = glm::length(d_vec);
-    const float min_dist = obj.radius + other.radius;
-    if (dist < min_dist){
-        glm::vec2 n = d_vec / dist;
-        const float total_mass = obj.mass + other.mass;
-        const float mass_ratio = obj.mass / total_mass;
+bool Solver::checkOneParticleCollision(size_t i, size_t j){
+    const bool asleep_i = i >= awake_count;
+    const bool asleep_j = j >= awake_count;
+    if (asleep_i && asleep_j){
+        return false;
+    }
+    float* __restrict xs = objects.x.data();
+    float* __restrict ys = objects.y.data();
+    const float dx = xs[i] - xs[j];
+    const float dy = ys[i] - ys[j];
+    const float dist2 = dx * dx + dy * dy;
+    const float min_dist = objects.radius[i] + objects.radius[j];
+    if (dist2 < min_dist * min_dist){
+        const float dist = std::sqrt(dist2);
+        // coincident particles (two queued spawns landing in the same step) separate along x
+        const float nx = dist > 0.0f ? dx / dist : 1.0f;
+        const float ny = dist > 0.0f ? dy / dist : 0.0f;
+        float share_i, share_j;
+        getSeparationShares(objects.mass[i], objects.mass[j], asleep_i, asleep_j, share_i, share_j);
         const float delta = 0.5f * (min_dist - dist);
 
-        obj.position += n * (1 - mass_ratio) * delta;
-        other.position -= n * mass_ratio * delta;
+        xs[i] += nx * share_i * delta;
+        ys[i] += ny * share_i * delta;
+        xs[j] -= nx * share_j * delta;
+        ys[j] -= ny * share_j * delta;
+        if ((asleep_i || asleep_j) && min_dist - dist > sleep_displacement){
+            sleep_slots[ThreadPool::getThreadIndex()].woken.push_back(static_cast<uint32_t>(asleep_i ? i : j));
+        }
+        return true;
     }
+    return false;
 }  
 
 void Solver::checkAllParticleCollisions(size_t start, size_t end) {
+    const size_t num_objects = objects.size();
     for (size_t i = start; i < end; ++i) {
-        for (size_t j = i + 1; j < objects.size(); ++j) {
-            checkOneParticleCollision(objects[i], objects[j]);
+        for (size_t j = i + 1; j < num_objects; ++j) {
+            checkOneParticleCollision(i, j);
         }
     }
 }
-
-
-
-
@@ -4,83 +4,313 @@
 
 #include <vector>
 #include <thread>
-#include <unordered_map>
-#include <GLFW/glfw3.h>
-#include <GL/GL.h>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <optional>
+#include <functional>
+#include <memory>
 #include <glm/glm.hpp>
 
 #include "../particle/particle.hpp"
+#include "../particleStore/particleStore.hpp"
 #include "../boundaries/boundaries.hpp"
+#include "../obstacles/obstacles.hpp"
+#include "../emitter/emitter.hpp"
+#include "../forceField/forceField.hpp"
+#include "../mortonOrder/mortonOrder.hpp"
+#include "../contactCache/contactCache.hpp"
+#include "../sleepTracker/sleepTracker.hpp"
 #include "../threadPool/threadPool.hpp"
+#include "../spatialGrid/spatialGrid.hpp"
+#include "../kernels/kernels.hpp"
+#include "../profiler/profiler.hpp"
+#include "../snapshot/snapshot.hpp"
+#include "../commandQueue/commandQueue.hpp"
+#include "../simClock/simClock.hpp"
+#include "../checkpoint/checkpoint.hpp"
+#include "../trajectory/trajectory.hpp"
 
-struct pair_hash {
-    template <class T1, class T2>
-    std::size_t operator() (const std::pair<T1, T2>& p) const {
-        auto hash1 = std::hash<T1>{}(p.first);
-        auto hash2 = std::hash<T2>{}(p.second);
-        return hash1 ^ (hash2 << 1); // or use boost::hash_combine
-    }
+enum class CollisionMode {
+    AllPairs,
+    Grid
+};
+
+// Phased runs gravity, integration, collisions and the boundary as separate parallel
+// sweeps. Fused merges the per-particle passes so only the collision step keeps a barrier.
+enum class PipelineMode {
+    Phased,
+    Fused
 };
 
 class Solver {
     public:
-        const float radius;
+        const float radius; // for particles added or spawned without one
         Solver(float radius);
         ~Solver();
 
-        Particle& addObject(glm::vec2 position);
+        // addObject and getObjects touch the particle arrays directly, so they are only
+        // safe while the update thread is not running (setup, benchmarks, tests) or
+        // from a step hook. The returned view, like its handle, survives the removal of
+        // other particles and goes invalid with its own.
+        ParticleView addObject(glm::vec2 position);
+        // any radius; the grid adds levels as the size range widens
+        ParticleView addObject(glm::vec2 position, float radius_);
+
+        // Reserves the particle arrays, grid and snapshots for max_objects particles, so
+        // no step reallocates. Queued spawns past the limit are dropped; step hooks
+        // should check getMaxObjects before adding. Defaults to SolverConstants::MAX_OBJECTS.
+        // Only while the update thread is not running.
+        void setMaxObjects(size_t max_objects_);
+        size_t getMaxObjects() const;
+
+        // thread-safe: queued, and compacted away at the next step boundary; stale
+        // handles are ignored. A step hook can mark particles on getObjects() directly.
+        void removeObject(ParticleHandle handle);
+        // true when no particle overlaps a disc at position. Uses the grid of the last
+        // collision pass plus any particles appended since, so call it from a step hook
+        bool isSpaceFree(glm::vec2 position, float radius_) const;
+
+        // Emitters run on the update thread at every step boundary, after queued
+        // commands and before the step hook. Only while the update thread is not running.
+        void addEmitter(const EmitterConfig& config);
+        void clearEmitters();
+        const std::vector<Emitter>& getEmitters() const;
+
+        // thread-safe: queued and applied by the update thread at the next step boundary;
+        // velocity is in units per second
+        void spawnObject(glm::vec2 position, glm::vec2 velocity);
+        void spawnObject(glm::vec2 position, glm::vec2 velocity, float radius_);
+        // thread-safe: the field acts over the next step only, so interactive callers
+        // send it again every frame. Bounded fields in grid mode only visit the cells
+        // their disc covers.
+        void applyForceField(const ForceField& field);
+        // a radial field of radius 120 around position
+        void mousePull(glm::vec2 position);
+
+        // Fields that act on every step, after the queued ones. Only while the update
+        // thread is not running.
+        void addForceField(const ForceField& field);
+        void clearForceFields();
+        const std::vector<ForceField>& getForceFields() const;
+
+        // newest published particle state; call from a single reader thread
+        const ParticleSnapshot& acquireSnapshot();
+        size_t getObjectCount() const;
 
-        void renderBoundary();
+        // where the render clock sits between the snapshot's previous and current
+        // positions, in [0, 1]; 1 when the update thread is not running
+        float getInterpolationAlpha(const ParticleSnapshot& snapshot) const;
 
         void startUpdateThread();
 
-        void addBoundary(std::unique_ptr<BoundingArea> boundary);
-        std::unique_ptr<BoundingArea>& getBoundary();
+        void addBoundary(Boundary boundary);
+        // nullptr when no boundary has been added
+        const Boundary* getBoundary() const;
+        // takes a baked field; only while the update thread is not running
+        void setObstacles(ObstacleField field);
+        const ObstacleField& getObstacles() const;
+        // net force the obstacles received over the last step (also in each snapshot)
+        glm::vec2 getObstacleForce() const;
 
-        std::vector<Particle>& getObjects();
+        // Runs on the update thread at the start of every step, after queued commands
+        // and before marked particles are compacted and the step's previous positions
+        // are captured. The hook may add, move and mark particles for removal. Set it
+        // while the update thread is not running.
+        void setStepHook(std::function<void(Solver&)> hook);
+        uint64_t getStepCount() const;
+
+        ParticleStore& getObjects();
         float getStepdt();
+        // velocities in units per second become displacements over this
+        float getSubstepdt() const;
         int getSubsteps();
+        SimdLevel getSimdLevel();
+        size_t getNumThreads() const;
+
+        // per-phase, per-thread and grid statistics; empty unless built with PARTICLE_PROFILING
+        SolverStats getStats();
+        void resetStats();
+        void setTraceEnabled(bool enabled);
+        bool writeTrace(const std::string& path);
 
-        void setObjectVelocity(Particle& obj, glm::vec2 v);
+        // v in units per second, like spawnObject and the emitters
+        void setObjectVelocity(ParticleView obj, glm::vec2 v);
         void setGravity(glm::vec2 g);
         void setStepDt(float dt);
         void setSubsteps(int substeps_);
+        void setCollisionMode(CollisionMode mode);
+        void setPipelineMode(PipelineMode mode);
+        void setSimdLevel(SimdLevel level);
+        // most steps the update thread runs to catch up before it drops the backlog
+        void setMaxStepsPerTick(int steps);
+        // In grid mode the particle arrays are re-sorted along a Z-order curve of their
+        // cells once the measured disorder passes threshold (0 disables). Handles stay
+        // valid across a re-sort, indices do not.
+        void setReorderThreshold(float threshold);
+        // 0 resolves every contact once per substep, straight from the grid. Above that,
+        // grid mode caches the contacts across substeps and relaxes them iterations times
+        // per substep, warm started from the previous one, so piles settle with fewer substeps.
+        void setContactIterations(int iterations);
+        // convergence of the last step; only while the update thread is not running
+        // (the residual is also in each snapshot)
+        ContactStats getContactStats() const;
+        // Grid mode only. A particle that moves slower than speed (units per second) for
+        // steps consecutive steps is at rest, and an island of touching particles that
+        // are all at rest falls asleep: its particles are skipped by every pass and only
+        // hold the awake ones off, until an impact, a force field, a removal or a step
+        // hook moving one of them wakes the island. speed 0 (the default) disables it.
+        void setSleepThreshold(float speed, int steps);
+        // asleep after the last step; only while the update thread is not running
+        size_t getSleepingCount() const;
 
-        void mousePull(glm::vec2 position);
+        void update();
+
+        // Full particle state (sleeping particles included), gravity, timestep, substeps,
+        // boundary and when the next re-sort and island search are due, so a restored
+        // run continues bit-identically; only cached contacts restart without a warm
+        // start. Only while the update thread is not running.
+        bool saveCheckpoint(const std::string& path);
+        bool loadCheckpoint(const std::string& path);
+
+        // records every interval-th step on the writer's own thread; detaching
+        // hands the writer back so the caller can close it and read its stats
+        void attachTrajectory(std::unique_ptr<TrajectoryWriter> writer);
+        std::unique_ptr<TrajectoryWriter> detachTrajectory();
 
-        private:
-        std::vector<Particle> objects;
-        float max_r = 0.0f;
+    private:
+        ParticleStore objects;
+        size_t max_objects = 0;
 
         glm::vec2 gravity = glm::vec2({0.0f, -9.81f});
         float bounce_coefficient = 0.9f;
         float step_dt = 1.0f / 60.0f;
         
         int substeps = 8;
+        CollisionMode collision_mode = CollisionMode::Grid;
+        PipelineMode pipeline_mode = PipelineMode::Fused;
 
         ThreadPool thread_pool;
-        bool update_thread_running;
+        std::atomic<bool> update_thread_running;
         std::thread update_thread;
 
-        std::unique_ptr<BoundingArea> bounding_area;
+        std::optional<Boundary> bounding_area;
+        ObstacleField obstacles;
+        // per-thread momentum the obstacles gave particles during the current step
+        struct alignas(64) MomentumSlot {
+            glm::vec2 momentum;
+        };
+        std::unique_ptr<MomentumSlot[]> obstacle_momentum;
+        glm::vec2 obstacle_force = glm::vec2(0.0f);
+        std::function<void(Solver&)> step_hook;
+        std::vector<Emitter> emitters;
+        std::vector<ForceField> force_fields;
+        std::vector<ForceField> queued_fields; // for the current step
+
+        HierarchicalGrid grid;
+        size_t grid_object_count = 0; // particles in the grid when it was last built
+
+        MortonOrder morton_order;
+        float reorder_threshold = 0.1f;
+        uint64_t next_disorder_check = 0;
+        uint64_t last_reorder_step = 0;
+
+        ContactCache contact_cache;
+        int contact_iterations = 0;
+        ContactStats contact_stats;      // of the last step
+        ContactStats step_contact_stats; // of the step in progress
+        // per-thread maxima of the contact sweeps
+        struct alignas(64) ContactSlot {
+            float overlap;
+            float displacement2;
+        };
+        std::unique_ptr<ContactSlot[]> contact_slots;
 
-        float cell_size;
-        std::unordered_map<std::pair<int, int>, std::vector<Particle*>, pair_hash> cell_map;
+        SleepTracker sleep_tracker;
+        float sleep_speed = 0.0f;
+        uint32_t sleep_steps = 1;
+        // an impact deeper than this wakes a sleeping particle: the sleep speed over a substep
+        float sleep_displacement = 0.0f;
+        size_t awake_count = 0; // particles [0, awake_count) are awake for the whole step
+        size_t sleeping_count = 0;
+        uint64_t next_island_check = 0;
+        std::vector<uint32_t> wake_queue;
+        // per-thread impacts on sleeping particles and particles at rest
+        struct alignas(64) SleepSlot {
+            std::vector<uint32_t> woken;
+            size_t resting;
+        };
+        std::unique_ptr<SleepSlot[]> sleep_slots;
+
+        SimdLevel simd_level;
+        Profiler profiler;
+
+        CommandQueue commands;
+        std::vector<SolverCommand> drained_commands;
+        SnapshotBuffer snapshots;
+        std::atomic<size_t> object_count;
+        uint64_t step_count = 0;
+        double sim_time = 0.0;
+        SimClock sim_clock;
+        std::unique_ptr<TrajectoryWriter> trajectory;
 
         void updateLoop();
-        void update();
+        void applyCommands();
+        void capturePreviousPositions();
+        void publishSnapshot();
+        void exertForceFields();
+        void exertForceField(const ForceField& field);
+        void updatePhased(float substep_dt);
+        void updateFused(float substep_dt);
+        template <typename Shape>
+        void fusedPass(float dt, bool constrain, const Shape* boundary, bool integrate, size_t start, size_t end);
+        void resolveCollisions();
+        bool hasGravity() const;
 
         void applyGravity(size_t start, size_t end);
-        void applyBoundary(size_t start, size_t end);
         void updateObjects(float dt, size_t start, size_t end);
 
-        void execInParallel(std::function<void(size_t, size_t)> func);
+        template <typename Func>
+        void execInParallel(const Func& func);
+        template <typename Func>
+        void execInParallel(size_t count, size_t min_chunk_size, const Func& func);
+        template <typename Func>
+        void visitBoundary(const Func& func);
 
+        void getDomainBounds(glm::vec2& min_corner, glm::vec2& max_corner) const;
+        bool reorderIfDisordered();
+        void assignGridLevels();
         void updateGrid();
-        std::pair<int, int> getCell(const glm::vec2& pos) const;
-        void checkNeighbouringCells(const std::pair<int, int>& cell);
+        template <typename Func>
+        void forEachNeighbourPair(const SpatialGrid& cells, int x, int y, const Func& func) const;
+        size_t checkNeighbouringCells(const SpatialGrid& cells, int x, int y);
+        size_t countPairTests(const SpatialGrid& cells, int x, int y) const;
+        void checkGridCollisions();
+        template <typename Func>
+        void forEachColouredBlock(const SpatialGrid& cells, const Func& func);
+        void checkCellBlock(const SpatialGrid& cells, int block_x, int block_y);
+        template <typename Func>
+        void forEachCrossLevelPair(size_t level, int x, int y, float margin, const Func& func) const;
+        void checkCrossLevelBlock(size_t level, int block_x, int block_y);
+
+        void resolveCachedContacts();
+        bool needsContactRebuild();
+        void buildContacts();
+        void buildContactBlock(const SpatialGrid& cells, int block_x, int block_y, std::vector<Contact>& contacts);
+        void buildCrossLevelContactBlock(size_t level, int block_x, int block_y, std::vector<Contact>& contacts);
+        template <typename Func>
+        void forEachContactBlock(const Func& func);
+        void warmStartContacts(std::vector<Contact>& contacts);
+        float relaxContacts(std::vector<Contact>& contacts);
+
+        bool isSleepEnabled() const;
+        void wakeAll();
+        void wakeDisturbed();
+        size_t wakeIslands();
+        void updateSleep();
+        void findIslands();
 
-        void checkOneParticleCollision(Particle& obj, Particle& other);
+        bool checkOneParticleCollision(size_t i, size_t j);
         void checkAllParticleCollisions(size_t start, size_t end);
 };
 
@@ -0,0 +1,279 @@
+#define GLM_ENABLE_EXPERIMENTAL
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <cmath>
+#include <glm/glm.hpp>
+
+#include "../particleStore/particleStore.hpp"
+#include "../threadPool/threadPool.hpp"
+#include "../profiler/profiler.hpp"
+
+#include "spatialGrid.hpp"
+
+namespace {
+    const size_t MIN_PARTICLES_PER_CHUNK = 2048;
+    const size_t MIN_CELLS_PER_CHUNK = 4096;
+    const float MIN_CELL_SIZE = 1e-3f; // keeps zero-radius particles from asking for endless levels
+    // The finest level gets at most this many cells per particle (and at least
+    // MIN_CAPPED_CELLS), so a few tiny particles cannot make it cover the domain
+    // with cells far smaller than the rest need; they share a coarser level instead.
+    const size_t MAX_CELLS_PER_PARTICLE = 64;
+    const size_t MIN_CAPPED_CELLS = 4096;
+}
+
+SpatialGrid::SpatialGrid()
+: origin({0.0f, 0.0f})
+, inv_cell_size(1.0f)
+, width(1)
+, height(1)
+, num_chunks(1)
+{}
+
+void SpatialGrid::configure(glm::vec2 min_corner, glm::vec2 max_corner, float cell_size) {
+    origin = min_corner;
+    inv_cell_size = 1.0f / cell_size;
+    width = std::max(1, static_cast<int>(std::ceil((max_corner.x - min_corner.x) * inv_cell_size)));
+    height = std::max(1, static_cast<int>(std::ceil((max_corner.y - min_corner.y) * inv_cell_size)));
+
+    // resize only reallocates when the grid grows past its previous capacity
+    cell_start.resize(static_cast<size_t>(width) * height + 1);
+}
+
+void SpatialGrid::reserve(size_t num_objects) {
+    particle_cells.reserve(num_objects);
+    particle_indices.reserve(num_objects);
+}
+
+void SpatialGrid::build(const ParticleStore& objects, ThreadPool& thread_pool) {
+    buildFrom(objects, nullptr, objects.size(), thread_pool);
+}
+
+void SpatialGrid::build(const ParticleStore& objects, const std::vector<uint32_t>& subset, ThreadPool& thread_pool) {
+    buildFrom(objects, subset.data(), subset.size(), thread_pool);
+}
+
+void SpatialGrid::buildFrom(const ParticleStore& objects, const uint32_t* subset, size_t num_objects, ThreadPool& thread_pool) {
+    const size_t num_cells = cell_start.size() - 1;
+    const size_t max_chunks = std::max<size_t>(1, thread_pool.getNumThreads());
+    num_chunks = std::min(max_chunks, std::max<size_t>(1, num_objects / MIN_PARTICLES_PER_CHUNK));
+    const size_t chunk_size = (num_objects + num_chunks - 1) / std::max<size_t>(1, num_chunks);
+
+    particle_cells.resize(num_objects);
+    particle_indices.resize(num_objects);
+    chunk_offsets.resize(num_chunks * num_cells);
+
+    // 1. bin every particle and count per chunk, so each chunk owns its own histogram
+    thread_pool.parallel_for(0, num_chunks, 1, [&](size_t chunk_start, size_t chunk_end) {
+        for (size_t chunk = chunk_start; chunk < chunk_end; ++chunk) {
+            uint32_t* counts = chunk_offsets.data() + chunk * num_cells;
+            std::fill(counts, counts + num_cells, 0u);
+
+            const size_t end = std::min(num_objects, (chunk + 1) * chunk_size);
+            for (size_t i = chunk * chunk_size; i < end; ++i) {
+                const size_t p = subset ? subset[i] : i;
+                const uint32_t cell = static_cast<uint32_t>(getCellIndex(getCellX(objects.x[p]), getCellY(objects.y[p])));
+                particle_cells[i] = cell;
+                ++counts[cell];
+            }
+        }
+    });
+
+    // 2. per cell, turn chunk counts into offsets relative to the start of the cell
+    const size_t cell_grain = num_chunks > 1 ? MIN_CELLS_PER_CHUNK : num_cells;
+    thread_pool.parallel_for(0, num_cells, cell_grain, [&](size_t start, size_t end) {
+        for (size_t cell = start; cell < end; ++cell) {
+            uint32_t total = 0;
+            for (size_t chunk = 0; chunk < num_chunks; ++chunk) {
+                uint32_t& offset = chunk_offsets[chunk * num_cells + cell];
+                const uint32_t count = offset;
+                offset = total;
+                total += count;
+            }
+            cell_start[cell + 1] = total;
+        }
+    });
+
+    // 3. exclusive scan of the cell totals
+    cell_start[0] = 0;
+    for (size_t cell = 0; cell < num_cells; ++cell) {
+        cell_start[cell + 1] += cell_start[cell];
+    }
+
+    // 4. scatter; chunks are visited in particle order (subsets are ascending), so every
+    //    cell lists its particles by index
+    thread_pool.parallel_for(0, num_chunks, 1, [&](size_t chunk_start, size_t chunk_end) {
+        for (size_t chunk = chunk_start; chunk < chunk_end; ++chunk) {
+            uint32_t* cursors = chunk_offsets.data() + chunk * num_cells;
+
+            const size_t end = std::min(num_objects, (chunk + 1) * chunk_size);
+            for (size_t i = chunk * chunk_size; i < end; ++i) {
+                const uint32_t cell = particle_cells[i];
+                particle_indices[cell_start[cell] + cursors[cell]++] = subset ? subset[i] : static_cast<uint32_t>(i);
+            }
+        }
+    });
+}
+
+GridStats SpatialGrid::computeStats() const {
+    GridStats stats;
+    stats.total_cells = static_cast<uint32_t>(cell_start.size() - 1);
+    for (size_t cell = 0; cell + 1 < cell_start.size(); ++cell) {
+        const uint32_t count = cell_start[cell + 1] - cell_start[cell];
+        stats.occupied_cells += count > 0;
+        stats.max_per_cell = std::max(stats.max_per_cell, count);
+    }
+    if (stats.occupied_cells > 0) {
+        stats.mean_per_occupied = static_cast<double>(particle_indices.size()) / stats.occupied_cells;
+    }
+    return stats;
+}
+
+int SpatialGrid::getWidth() const {
+    return width;
+}
+
+int SpatialGrid::getHeight() const {
+    return height;
+}
+
+int SpatialGrid::getCellX(float x) const {
+    // clamp before the cast so far away or NaN positions still land in a border cell
+    const float cell = std::floor((x - origin.x) * inv_cell_size);
+    return static_cast<int>(std::fmin(std::fmax(cell, 0.0f), static_cast<float>(width - 1)));
+}
+
+int SpatialGrid::getCellY(float y) const {
+    // clamp before the cast so far away or NaN positions still land in a border cell
+    const float cell = std::floor((y - origin.y) * inv_cell_size);
+    return static_cast<int>(std::fmin(std::fmax(cell, 0.0f), static_cast<float>(height - 1)));
+}
+
+HierarchicalGrid::HierarchicalGrid() {
+    addLevel();
+}
+
+void HierarchicalGrid::addLevel() {
+    levels.emplace_back();
+    members.emplace_back();
+    counts.push_back(0);
+    max_radii.push_back(0.0f);
+    levels.back().reserve(reserved);
+    members.back().reserve(reserved);
+}
+
+void HierarchicalGrid::reserve(size_t num_objects) {
+    reserved = num_objects;
+    for (size_t level = 0; level < levels.size(); ++level) {
+        levels[level].reserve(num_objects);
+        members[level].reserve(num_objects);
+    }
+}
+
+void HierarchicalGrid::assignLevels(const ParticleStore& objects, glm::vec2 min_corner, glm::vec2 max_corner, float skin_fraction) {
+    const size_t num_objects = objects.size();
+    const float* radii = objects.radius.data();
+    float min_radius = num_objects > 0 ? radii[0] : 0.0f;
+    float max_radius = min_radius;
+    for (size_t i = 1; i < num_objects; ++i) {
+        min_radius = std::min(min_radius, radii[i]);
+        max_radius = std::max(max_radius, radii[i]);
+    }
+
+    skin = skin_fraction * 2.0f * min_radius;
+    const float area = std::max(max_corner.x - min_corner.x, 0.0f) * std::max(max_corner.y - min_corner.y, 0.0f);
+    const size_t max_cells = std::max(MIN_CAPPED_CELLS, MAX_CELLS_PER_PARTICLE * num_objects);
+    const float min_cell_size = std::max(std::sqrt(area / static_cast<float>(max_cells)), MIN_CELL_SIZE);
+    base_cell_size = std::max(2.0f * min_radius + skin, min_cell_size);
+    level_count = 1;
+    for (float cell = base_cell_size; cell < 2.0f * max_radius + skin; cell *= 2.0f) {
+        ++level_count;
+    }
+    while (levels.size() < level_count) {
+        addLevel();
+    }
+
+    if (level_count == 1) {
+        counts[0] = num_objects;
+        max_radii[0] = max_radius;
+        return;
+    }
+    for (size_t level = 0; level < level_count; ++level) {
+        members[level].clear();
+        max_radii[level] = 0.0f;
+    }
+    for (size_t i = 0; i < num_objects; ++i) {
+        size_t level = 0;
+        for (float cell = base_cell_size; cell < 2.0f * radii[i] + skin; cell *= 2.0f) {
+            ++level;
+        }
+        members[level].push_back(static_cast<uint32_t>(i));
+        max_radii[level] = std::max(max_radii[level], radii[i]);
+    }
+    for (size_t level = 0; level < level_count; ++level) {
+        counts[level] = members[level].size();
+    }
+}
+
+void HierarchicalGrid::configure(glm::vec2 min_corner, glm::vec2 max_corner) {
+    float cell = base_cell_size;
+    for (size_t level = 0; level < level_count; ++level, cell *= 2.0f) {
+        levels[level].configure(min_corner, max_corner, cell);
+    }
+}
+
+void HierarchicalGrid::build(const ParticleStore& objects, ThreadPool& thread_pool) {
+    if (level_count == 1) {
+        levels[0].build(objects, thread_pool);
+        return;
+    }
+    for (size_t level = 0; level < level_count; ++level) {
+        if (counts[level] > 0) {
+            levels[level].build(objects, members[level], thread_pool);
+        }
+    }
+}
+
+size_t HierarchicalGrid::getLevelCount() const {
+    return level_count;
+}
+
+float HierarchicalGrid::getBaseCellSize() const {
+    return base_cell_size;
+}
+
+float HierarchicalGrid::getSkin() const {
+    return skin;
+}
+
+const SpatialGrid& HierarchicalGrid::getLevel(size_t level) const {
+    return levels[level];
+}
+
+size_t HierarchicalGrid::getObjectCount(size_t level) const {
+    return counts[level];
+}
+
+float HierarchicalGrid::getMaxRadius(size_t level) const {
+    return max_radii[level];
+}
+
+GridStats HierarchicalGrid::computeStats() const {
+    GridStats stats;
+    size_t binned = 0;
+    for (size_t level = 0; level < level_count; ++level) {
+        if (counts[level] == 0) {
+            continue;
+        }
+        const GridStats level_stats = levels[level].computeStats();
+        stats.total_cells += level_stats.total_cells;
+        stats.occupied_cells += level_stats.occupied_cells;
+        stats.max_per_cell = std::max(stats.max_per_cell, level_stats.max_per_cell);
+        binned += counts[level];
+    }
+    if (stats.occupied_cells > 0) {
+        stats.mean_per_occupied = static_cast<double>(binned) / stats.occupied_cells;
+    }
+    return stats;
+}
@@ -0,0 +1,106 @@
+#define GLM_ENABLE_EXPERIMENTAL
+#ifndef SPATIAL_GRID_HPP
+#define SPATIAL_GRID_HPP
+
+#include <vector>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+#include "../particleStore/particleStore.hpp"
+#include "../threadPool/threadPool.hpp"
+#include "../profiler/profiler.hpp"
+
+// Dense uniform grid rebuilt with a counting sort. Cells are stored column-major
+// (cell = x * height + y) so a column of cells is contiguous in memory. Particles
+// outside the configured area are clamped into the border cells.
+class SpatialGrid {
+    public:
+        SpatialGrid();
+
+        void configure(glm::vec2 min_corner, glm::vec2 max_corner, float cell_size);
+        void build(const ParticleStore& objects, ThreadPool& thread_pool);
+        // bins only the listed particles, which must be ascending; cells hold store indices
+        void build(const ParticleStore& objects, const std::vector<uint32_t>& subset, ThreadPool& thread_pool);
+        // sizes the per-particle arrays so building over up to num_objects never reallocates
+        void reserve(size_t num_objects);
+
+        int getWidth() const;
+        int getHeight() const;
+        int getCellX(float x) const;
+        int getCellY(float y) const;
+        GridStats computeStats() const;
+
+        int getCellIndex(int x, int y) const {
+            return x * height + y;
+        }
+
+        const uint32_t* cellBegin(int cell) const {
+            return particle_indices.data() + cell_start[cell];
+        }
+
+        const uint32_t* cellEnd(int cell) const {
+            return particle_indices.data() + cell_start[cell + 1];
+        }
+
+    private:
+        glm::vec2 origin;
+        float inv_cell_size;
+        int width;
+        int height;
+        size_t num_chunks;
+
+        std::vector<uint32_t> cell_start;       // num_cells + 1 offsets into particle_indices
+        std::vector<uint32_t> chunk_offsets;    // per chunk, per cell counts then write cursors
+        std::vector<uint32_t> particle_cells;   // cell of each particle
+        std::vector<uint32_t> particle_indices; // particle indices sorted by cell
+
+        void buildFrom(const ParticleStore& objects, const uint32_t* subset, size_t num_objects, ThreadPool& thread_pool);
+};
+
+// Grid levels for particles of mixed sizes. Level k has cells of base * 2^k, where base
+// is the smallest particle's diameter, and every particle is binned at the first level
+// whose cells hold its diameter. Pairs on one level then only meet in neighbouring
+// cells, and a large particle looks up the finer levels around it, so a wide size
+// range does not blow up the small particles' cells. With a single radius there is
+// one level, built exactly like a plain SpatialGrid.
+class HierarchicalGrid {
+    public:
+        HierarchicalGrid();
+
+        // sorts the particles into levels by radius; call whenever particles were added,
+        // removed or resized, every build reuses the levels until then. A skin widens
+        // every cell by that fraction of the smallest diameter, so pairs up to that far
+        // apart still only meet in neighbouring cells. The domain bounds how fine the
+        // first level may get, so its cell count stays proportional to the particles.
+        void assignLevels(const ParticleStore& objects, glm::vec2 min_corner, glm::vec2 max_corner, float skin_fraction = 0.0f);
+        void configure(glm::vec2 min_corner, glm::vec2 max_corner);
+        void build(const ParticleStore& objects, ThreadPool& thread_pool);
+        void reserve(size_t num_objects);
+
+        size_t getLevelCount() const;
+        // cell size of level 0, as of the last assignLevels
+        float getBaseCellSize() const;
+        // width of the skin, as of the last assignLevels
+        float getSkin() const;
+        const SpatialGrid& getLevel(size_t level) const;
+        size_t getObjectCount(size_t level) const;
+        // largest radius binned at the level
+        float getMaxRadius(size_t level) const;
+        // summed over the levels; max_per_cell is the largest of any level
+        GridStats computeStats() const;
+
+    private:
+        // the vectors only grow; level_count says how many are in use
+        std::vector<SpatialGrid> levels;
+        std::vector<std::vector<uint32_t>> members; // ascending, unused with a single level
+        std::vector<size_t> counts;
+        std::vector<float> max_radii;
+        size_t level_count = 1;
+        float base_cell_size = 1.0f;
+        float skin = 0.0f;
+        size_t reserved = 0;
+
+        void addLevel();
+};
+
+#endif
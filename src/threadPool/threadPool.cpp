@@ -1,70 +1,197 @@
 #include <condition_variable>
-#include <functional>
-#include <iostream>
 #include <mutex>
-#include <queue>
 #include <thread>
 #include <atomic>
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#include <immintrin.h>
+#define CPU_RELAX() _mm_pause()
+#else
+#define CPU_RELAX() std::this_thread::yield()
+#endif
 
 #include "threadPool.hpp"
 
+namespace {
+    // idle workers spin, then yield, then park
+    const int SPIN_ITERATIONS = 4096;
+    const int YIELD_ITERATIONS = 64;
+
+    thread_local size_t thread_index = 0;
+
+    inline uint64_t packRange(size_t begin, size_t end) {
+        return (static_cast<uint64_t>(begin) << 32) | static_cast<uint32_t>(end);
+    }
+
+    inline size_t rangeBegin(uint64_t range) {
+        return static_cast<size_t>(range >> 32);
+    }
+
+    inline size_t rangeEnd(uint64_t range) {
+        return static_cast<size_t>(range & 0xffffffffu);
+    }
+}
+
 ThreadPool::ThreadPool(size_t num_threads)
-    : num_threads(num_threads), stop(false), active_tasks(0) {
-    for (size_t i = 0; i < num_threads; ++i) {
-        threads.emplace_back([this] {
-            while (true) {
-                std::function<void()> task;
-                {
-                    std::unique_lock<std::mutex> lock(queue_mutex);
-                    condition.wait(lock, [this] {
-                        return !tasks.empty() || stop;
-                    });
-                    if (stop && tasks.empty()) {
-                        return;
-                    }
-                    task = std::move(tasks.front());
-                    tasks.pop();
-                    ++active_tasks;
-                }
-                task();
-                {
-                    std::unique_lock<std::mutex> lock(queue_mutex);
-                    --active_tasks;
-                    if (tasks.empty() && active_tasks == 0) {
-                        condition.notify_all();
-                    }
-                }
-            }
-        });
+    : num_threads(num_threads + 1)
+    , ranges(new WorkRange[num_threads + 1])
+    , epoch(0)
+    , remaining(0)
+    , parked(0)
+    , stop(false) {
+    job = {nullptr, nullptr, 1};
+    for (size_t i = 0; i <= num_threads; ++i) {
+        ranges[i].range.store(0, std::memory_order_relaxed);
+        ranges[i].done_epoch.store(0, std::memory_order_relaxed);
+    }
+    // slot 0 belongs to the thread calling parallel_for
+    for (size_t i = 1; i <= num_threads; ++i) {
+        threads.emplace_back(&ThreadPool::workerLoop, this, i);
     }
 }
 
 ThreadPool::~ThreadPool() {
     {
-        std::unique_lock<std::mutex> lock(queue_mutex);
+        std::unique_lock<std::mutex> lock(park_mutex);
         stop = true;
     }
-    condition.notify_all();
+    park_condition.notify_all();
     for (auto& thread : threads) {
         thread.join();
     }
 }
 
-void ThreadPool::enqueue(std::function<void()> task) {
-    {
-        std::unique_lock<std::mutex> lock(queue_mutex);
-        tasks.emplace(std::move(task));
+size_t ThreadPool::getNumThreads() const {
+    return num_threads;
+}
+
+size_t ThreadPool::getThreadIndex() {
+    return thread_index;
+}
+
+void ThreadPool::run(const Job& job_, size_t begin, size_t end) {
+    job = job_;
+
+    const size_t count = end - begin;
+    const size_t slice = (count + num_threads - 1) / num_threads;
+    for (size_t i = 0; i < num_threads; ++i) {
+        const size_t slice_begin = std::min(end, begin + i * slice);
+        const size_t slice_end = std::min(end, slice_begin + slice);
+        ranges[i].range.store(packRange(slice_begin, slice_end), std::memory_order_relaxed);
+    }
+    remaining.store(count, std::memory_order_relaxed);
+
+    // publishing the epoch releases the job and the ranges to the workers
+    const uint64_t current_epoch = epoch.load(std::memory_order_relaxed) + 1;
+    epoch.store(current_epoch, std::memory_order_seq_cst);
+    if (parked.load(std::memory_order_seq_cst) > 0) {
+        std::lock_guard<std::mutex> lock(park_mutex);
+        park_condition.notify_all();
+    }
+
+    executeJob(0);
+
+    // Join: wait until all work is done and every worker has left this job, so
+    // none of them can touch `job` or `ranges` once the next call rewrites them.
+    int spins = 0;
+    size_t worker = 1;
+    while (worker < num_threads || remaining.load(std::memory_order_acquire) != 0) {
+        if (worker < num_threads && ranges[worker].done_epoch.load(std::memory_order_acquire) == current_epoch) {
+            ++worker;
+            continue;
+        }
+        if (spins++ < SPIN_ITERATIONS) {
+            CPU_RELAX();
+        }
+        else {
+            std::this_thread::yield();
+        }
     }
-    condition.notify_one();
 }
 
-void ThreadPool::wait_for_tasks() {
-    std::unique_lock<std::mutex> lock(queue_mutex);
-    condition.wait(lock, [this] {
-        return tasks.empty() && active_tasks == 0;
-    });
+void ThreadPool::workerLoop(size_t self) {
+    thread_index = self;
+    uint64_t seen_epoch = 0;
+    while (true) {
+        uint64_t current_epoch;
+        int spins = 0;
+        while ((current_epoch = epoch.load(std::memory_order_acquire)) == seen_epoch) {
+            if (stop.load(std::memory_order_relaxed)) {
+                return;
+            }
+            if (spins < SPIN_ITERATIONS) {
+                CPU_RELAX();
+                ++spins;
+            }
+            else if (spins < SPIN_ITERATIONS + YIELD_ITERATIONS) {
+                std::this_thread::yield();
+                ++spins;
+            }
+            else {
+                std::unique_lock<std::mutex> lock(park_mutex);
+                parked.fetch_add(1, std::memory_order_seq_cst);
+                park_condition.wait(lock, [this, seen_epoch] {
+                    return epoch.load(std::memory_order_seq_cst) != seen_epoch || stop.load(std::memory_order_relaxed);
+                });
+                parked.fetch_sub(1, std::memory_order_relaxed);
+                spins = 0;
+            }
+        }
+
+        executeJob(self);
+        seen_epoch = current_epoch;
+        ranges[self].done_epoch.store(current_epoch, std::memory_order_release);
+    }
 }
 
-size_t ThreadPool::getNumThreads() const {
-    return num_threads;
+void ThreadPool::executeJob(size_t self) {
+    size_t start, end;
+    do {
+        while (popFront(self, start, end)) {
+            job.invoke(job.func, start, end);
+            remaining.fetch_sub(end - start, std::memory_order_acq_rel);
+        }
+    } while (steal(self));
+}
+
+bool ThreadPool::popFront(size_t self, size_t& start, size_t& end) {
+    std::atomic<uint64_t>& range = ranges[self].range;
+    uint64_t current = range.load(std::memory_order_acquire);
+    while (true) {
+        const size_t begin = rangeBegin(current);
+        const size_t stop_at = rangeEnd(current);
+        if (begin >= stop_at) {
+            return false;
+        }
+        const size_t next = std::min(stop_at, begin + job.grain);
+        if (range.compare_exchange_weak(current, packRange(next, stop_at), std::memory_order_acq_rel)) {
+            start = begin;
+            end = next;
+            return true;
+        }
+    }
+}
+
+bool ThreadPool::steal(size_t self) {
+    for (size_t k = 1; k < num_threads; ++k) {
+        std::atomic<uint64_t>& victim = ranges[(self + k) % num_threads].range;
+        uint64_t current = victim.load(std::memory_order_acquire);
+        while (true) {
+            const size_t begin = rangeBegin(current);
+            const size_t end = rangeEnd(current);
+            if (begin >= end) {
+                break;
+            }
+            // take the back half, or everything when only one grain is left
+            const size_t count = end - begin;
+            const size_t take = count <= job.grain ? count : count / 2;
+            const size_t mid = end - take;
+            if (victim.compare_exchange_weak(current, packRange(begin, mid), std::memory_order_acq_rel)) {
+                ranges[self].range.store(packRange(mid, end), std::memory_order_release);
+                return true;
+            }
+        }
+    }
+    return false;
 }
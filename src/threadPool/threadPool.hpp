@@ -2,30 +2,80 @@
 #define THREAD_POOL_HPP
 
 #include <condition_variable>
-#include <functional>
 #include <mutex>
-#include <queue>
 #include <thread>
 #include <atomic>
+#include <vector>
+#include <memory>
+#include <cstdint>
 
+// Work-stealing fork/join pool. parallel_for splits a range into one slice per
+// participating thread (the workers plus the caller). Each thread takes grain-sized
+// pieces from the front of its own slice, and steals half of another slice from
+// the back when its own runs dry. Jobs are passed as a function pointer plus a
+// pointer to the caller's functor, so nothing is heap allocated per call.
+// Idle workers spin for a while before parking on a condition variable.
+// parallel_for must not be called from inside a job or from two threads at once.
 class ThreadPool {
     public:
         ThreadPool(size_t num_threads);
         ~ThreadPool();
 
-        void enqueue(std::function<void()> task);
-        void wait_for_tasks();
+        template <typename Func>
+        void parallel_for(size_t begin, size_t end, size_t grain, const Func& func) {
+            if (begin >= end) {
+                return;
+            }
+            if (threads.empty() || end - begin <= grain) {
+                func(begin, end);
+                return;
+            }
+            Job job;
+            job.invoke = [](const void* f, size_t start, size_t stop) {
+                (*static_cast<const Func*>(f))(start, stop);
+            };
+            job.func = &func;
+            job.grain = grain == 0 ? 1 : grain;
+            run(job, begin, end);
+        }
 
+        // Threads taking part in a parallel_for, including the calling thread
         size_t getNumThreads() const;
 
+        // Index of the calling thread inside the pool: workers are 1..n-1, any other thread is 0
+        static size_t getThreadIndex();
+
     private:
+        struct Job {
+            void (*invoke)(const void* func, size_t start, size_t end);
+            const void* func;
+            size_t grain;
+        };
+
+        // [begin, end) packed into one word so owner pops and thief steals are a single CAS
+        struct alignas(64) WorkRange {
+            std::atomic<uint64_t> range;
+            std::atomic<uint64_t> done_epoch;
+        };
+
         size_t num_threads;
         std::vector<std::thread> threads;
-        std::queue<std::function<void()>> tasks;
-        std::mutex queue_mutex;
-        std::condition_variable condition;
-        std::atomic<size_t> active_tasks;
-        bool stop;
+        std::unique_ptr<WorkRange[]> ranges;
+
+        Job job;
+        std::atomic<uint64_t> epoch;
+        std::atomic<size_t> remaining;
+
+        std::mutex park_mutex;
+        std::condition_variable park_condition;
+        std::atomic<size_t> parked;
+        std::atomic<bool> stop;
+
+        void run(const Job& job_, size_t begin, size_t end);
+        void workerLoop(size_t self);
+        void executeJob(size_t self);
+        bool popFront(size_t self, size_t& start, size_t& end);
+        bool steal(size_t self);
 };
 
-#endif
\ No newline at end of file
+#endif
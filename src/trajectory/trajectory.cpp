@@ -0,0 +1,593 @@
+#include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <cmath>
+
+#include "../particleStore/particleStore.hpp"
+
+#include "trajectory.hpp"
+
+namespace {
+    const char FILE_MAGIC[8] = {'P', 'S', 'I', 'M', 'T', 'R', 'A', 'J'};
+    const char FOOTER_MAGIC[8] = {'P', 'S', 'I', 'M', 'T', 'E', 'N', 'D'};
+    const uint32_t CHUNK_MAGIC = 0x4b4e4843; // "CHNK"
+
+    struct TrajectoryHeader {
+        char magic[8];
+        uint32_t version;
+        float precision;
+        int32_t interval;
+        uint32_t reserved;
+    };
+
+    struct ChunkHeader {
+        uint32_t magic;
+        uint32_t frame_count;
+        uint64_t first_frame;
+        uint64_t byte_size; // frames following this header
+    };
+
+    struct FrameHeader {
+        uint64_t step;
+        double sim_time;
+        uint32_t particle_count;
+        uint32_t payload_size;
+    };
+
+    struct ChunkIndexEntry {
+        uint64_t first_frame;
+        uint64_t frame_count;
+        uint64_t offset;
+    };
+
+    struct TrajectoryFooter {
+        uint64_t index_offset;
+        uint64_t chunk_count;
+        char magic[8];
+    };
+
+    bool seekTo(FILE* file, uint64_t offset) {
+#ifdef _WIN32
+        return _fseeki64(file, static_cast<int64_t>(offset), SEEK_SET) == 0;
+#else
+        return fseeko(file, static_cast<off_t>(offset), SEEK_SET) == 0;
+#endif
+    }
+
+    uint64_t fileSize(FILE* file) {
+#ifdef _WIN32
+        _fseeki64(file, 0, SEEK_END);
+        return static_cast<uint64_t>(_ftelli64(file));
+#else
+        fseeko(file, 0, SEEK_END);
+        return static_cast<uint64_t>(ftello(file));
+#endif
+    }
+
+    template <typename T>
+    void append(std::vector<uint8_t>& out, const T& value) {
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+        out.insert(out.end(), bytes, bytes + sizeof(T));
+    }
+
+    inline void putVarint(std::vector<uint8_t>& out, int64_t value) {
+        // zigzag keeps small negative residuals small
+        uint64_t bits = (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+        while (bits >= 0x80) {
+            out.push_back(static_cast<uint8_t>(bits | 0x80));
+            bits >>= 7;
+        }
+        out.push_back(static_cast<uint8_t>(bits));
+    }
+
+    inline bool getVarint(const uint8_t*& in, const uint8_t* end, int64_t& value) {
+        uint64_t bits = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (in == end) {
+                return false;
+            }
+            const uint8_t byte = *in++;
+            bits |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if (byte < 0x80) {
+                value = static_cast<int64_t>(bits >> 1) ^ -static_cast<int64_t>(bits & 1);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // prediction for a particle from its last one or two frames, at match in the previous track
+    inline int64_t predict(const std::vector<int32_t>& last, const std::vector<int32_t>& before, uint8_t depth, size_t match) {
+        if (depth >= 2) {
+            return 2 * static_cast<int64_t>(last[match]) - before[match];
+        }
+        return last[match];
+    }
+
+    inline int32_t quantise(float value, float inv_precision) {
+        const double q = std::nearbyint(static_cast<double>(value) * inv_precision);
+        return static_cast<int32_t>(std::max(-2147483647.0, std::min(2147483647.0, q)));
+    }
+}
+
+void TrajectoryTrack::resize(size_t count) {
+    handles.resize(count);
+    for (int back = 0; back < 2; ++back) {
+        x[back].resize(count);
+        y[back].resize(count);
+    }
+    depth.resize(count);
+}
+
+void TrajectoryTrack::clear() {
+    resize(0);
+}
+
+TrajectoryWriter::TrajectoryWriter(const std::string& path, const TrajectoryOptions& options_)
+: options(options_)
+, file(std::fopen(path.c_str(), "wb"))
+, frames(std::max(1, options_.queue_depth))
+, closing(false)
+, chunk_first_frame(0)
+, chunk_frame_count(0)
+, frame_index(0)
+, file_offset(0)
+{
+    options.interval = std::max(1, options.interval);
+    options.chunk_frames = std::max(1, options.chunk_frames);
+    if (!file) {
+        std::cerr << "Could not open trajectory " << path << std::endl;
+        return;
+    }
+
+    TrajectoryHeader header = {};
+    std::memcpy(header.magic, FILE_MAGIC, sizeof(FILE_MAGIC));
+    header.version = TRAJECTORY_VERSION;
+    header.precision = options.precision;
+    header.interval = options.interval;
+    std::fwrite(&header, sizeof(header), 1, file);
+    file_offset = sizeof(header);
+
+    for (TrajectoryFrame& frame : frames) {
+        free_frames.push_back(&frame);
+    }
+    worker = std::thread(&TrajectoryWriter::workerLoop, this);
+}
+
+TrajectoryWriter::~TrajectoryWriter() {
+    close();
+}
+
+bool TrajectoryWriter::isOpen() const {
+    return file != nullptr;
+}
+
+int TrajectoryWriter::getInterval() const {
+    return options.interval;
+}
+
+TrajectoryStats TrajectoryWriter::getStats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
+
+void TrajectoryWriter::submit(uint64_t step, double sim_time, const ParticleStore& objects) {
+    if (!file) {
+        return;
+    }
+
+    TrajectoryFrame* frame;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (free_frames.empty()) {
+            ++stats.stalls;
+            buffer_free.wait(lock, [this] { return !free_frames.empty(); });
+        }
+        frame = free_frames.back();
+        free_frames.pop_back();
+    }
+
+    frame->step = step;
+    frame->sim_time = sim_time;
+    frame->x.assign(objects.x.begin(), objects.x.end());
+    frame->y.assign(objects.y.begin(), objects.y.end());
+    frame->handles.resize(objects.size());
+    for (size_t i = 0; i < objects.size(); ++i) {
+        frame->handles[i] = objects.handleAt(i);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending.push_back(frame);
+    }
+    frame_ready.notify_one();
+}
+
+void TrajectoryWriter::close() {
+    if (!file) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        closing = true;
+    }
+    frame_ready.notify_one();
+    worker.join();
+    std::fclose(file);
+    file = nullptr;
+}
+
+void TrajectoryWriter::workerLoop() {
+    while (true) {
+        TrajectoryFrame* frame;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            frame_ready.wait(lock, [this] { return !pending.empty() || closing; });
+            if (pending.empty()) {
+                break;
+            }
+            frame = pending.front();
+            pending.erase(pending.begin());
+        }
+
+        const size_t payload_start = chunk.size();
+        encodeFrame(*frame);
+        const uint64_t payload = chunk.size() - payload_start - sizeof(FrameHeader);
+        const uint64_t particles = frame->x.size();
+        if (chunk_frame_count == static_cast<uint32_t>(options.chunk_frames)) {
+            flushChunk();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ++stats.frames;
+            stats.particles += particles;
+            stats.bytes += payload;
+            free_frames.push_back(frame);
+        }
+        buffer_free.notify_one();
+    }
+
+    flushChunk();
+    TrajectoryFooter footer = {};
+    footer.index_offset = file_offset;
+    footer.chunk_count = index.size() / 3;
+    std::memcpy(footer.magic, FOOTER_MAGIC, sizeof(FOOTER_MAGIC));
+    std::fwrite(index.data(), sizeof(uint64_t), index.size(), file);
+    if (std::fwrite(&footer, sizeof(footer), 1, file) != 1) {
+        std::cerr << "Failed to finish trajectory file" << std::endl;
+    }
+}
+
+void TrajectoryWriter::encodeFrame(const TrajectoryFrame& frame) {
+    const size_t count = frame.x.size();
+    if (chunk_frame_count == 0) {
+        chunk_first_frame = frame_index;
+    }
+
+    const size_t header_offset = chunk.size();
+    append(chunk, FrameHeader());
+
+    // slots are dense, so scattering the particles by slot sorts them in one pass
+    uint32_t slot_end = 0;
+    for (const ParticleHandle& handle : frame.handles) {
+        slot_end = std::max(slot_end, handle.slot + 1);
+    }
+    slot_order.assign(slot_end, UINT32_MAX);
+    for (size_t i = 0; i < count; ++i) {
+        slot_order[frame.handles[i].slot] = static_cast<uint32_t>(i);
+    }
+
+    const float inv_precision = 1.0f / options.precision;
+    const TrajectoryTrack& last = tracks[0];
+    TrajectoryTrack& next = tracks[1];
+    next.resize(count);
+    size_t k = 0;
+    size_t match = 0; // both tracks are in slot order, so one pass pairs them up
+    uint32_t expected_slot = 0;
+    for (uint32_t slot = 0; slot < slot_end; ++slot) {
+        const uint32_t i = slot_order[slot];
+        if (i == UINT32_MAX) {
+            continue;
+        }
+        const ParticleHandle handle = frame.handles[i];
+        while (match < last.handles.size() && last.handles[match].slot < slot) {
+            ++match;
+        }
+        const bool known = match < last.handles.size() && last.handles[match] == handle;
+        const int32_t qx = quantise(frame.x[i], inv_precision);
+        const int32_t qy = quantise(frame.y[i], inv_precision);
+
+        putVarint(chunk, (static_cast<int64_t>(slot - expected_slot) << 1) | (known ? 0 : 1));
+        expected_slot = slot + 1;
+        if (known) {
+            putVarint(chunk, qx - predict(last.x[0], last.x[1], last.depth[match], match));
+            putVarint(chunk, qy - predict(last.y[0], last.y[1], last.depth[match], match));
+            next.x[1][k] = last.x[0][match];
+            next.y[1][k] = last.y[0][match];
+            next.depth[k] = 2;
+        }
+        else {
+            putVarint(chunk, handle.generation);
+            putVarint(chunk, qx);
+            putVarint(chunk, qy);
+            next.depth[k] = 1;
+        }
+        next.handles[k] = handle;
+        next.x[0][k] = qx;
+        next.y[0][k] = qy;
+        ++k;
+    }
+    // newest frame first
+    std::swap(tracks[0], tracks[1]);
+
+    FrameHeader header;
+    header.step = frame.step;
+    header.sim_time = frame.sim_time;
+    header.particle_count = static_cast<uint32_t>(count);
+    header.payload_size = static_cast<uint32_t>(chunk.size() - header_offset - sizeof(FrameHeader));
+    std::memcpy(chunk.data() + header_offset, &header, sizeof(header));
+
+    ++chunk_frame_count;
+    ++frame_index;
+}
+
+void TrajectoryWriter::flushChunk() {
+    if (chunk_frame_count == 0) {
+        return;
+    }
+    ChunkHeader header;
+    header.magic = CHUNK_MAGIC;
+    header.frame_count = chunk_frame_count;
+    header.first_frame = chunk_first_frame;
+    header.byte_size = chunk.size();
+
+    index.push_back(chunk_first_frame);
+    index.push_back(chunk_frame_count);
+    index.push_back(file_offset);
+
+    const bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1
+                 && std::fwrite(chunk.data(), 1, chunk.size(), file) == chunk.size();
+    if (!ok) {
+        std::cerr << "Failed to write trajectory chunk" << std::endl;
+    }
+    file_offset += sizeof(header) + chunk.size();
+
+    chunk.clear();
+    chunk_frame_count = 0;
+    tracks[0].clear();
+    tracks[1].clear();
+}
+
+TrajectoryReader::TrajectoryReader()
+: file(nullptr)
+, precision(0.0f)
+, interval(1)
+, frame_count(0)
+, loaded_chunk(SIZE_MAX)
+, cursor(0)
+, next_frame(0)
+{}
+
+TrajectoryReader::~TrajectoryReader() {
+    close();
+}
+
+void TrajectoryReader::close() {
+    if (file) {
+        std::fclose(file);
+        file = nullptr;
+    }
+    chunks.clear();
+    frame_count = 0;
+    loaded_chunk = SIZE_MAX;
+}
+
+size_t TrajectoryReader::getFrameCount() const {
+    return frame_count;
+}
+
+float TrajectoryReader::getPrecision() const {
+    return precision;
+}
+
+int TrajectoryReader::getInterval() const {
+    return interval;
+}
+
+bool TrajectoryReader::open(const std::string& path) {
+    close();
+    file = std::fopen(path.c_str(), "rb");
+    if (!file) {
+        std::cerr << "Could not open trajectory " << path << std::endl;
+        return false;
+    }
+
+    TrajectoryHeader header = {};
+    if (std::fread(&header, sizeof(header), 1, file) != 1 || std::memcmp(header.magic, FILE_MAGIC, sizeof(FILE_MAGIC)) != 0
+        || header.version != TRAJECTORY_VERSION || !(header.precision > 0.0f)) {
+        const bool version_1 = std::memcmp(header.magic, FILE_MAGIC, sizeof(FILE_MAGIC)) == 0 && header.version == 1;
+        std::cerr << path << (version_1 ? " is a version 1 trajectory, whose frames do not follow particles; record it again"
+                                        : " is not a supported trajectory file") << std::endl;
+        close();
+        return false;
+    }
+    precision = header.precision;
+    interval = header.interval;
+
+    const uint64_t size = fileSize(file);
+    TrajectoryFooter footer;
+    bool indexed = size >= sizeof(header) + sizeof(footer) && seekTo(file, size - sizeof(footer))
+                && std::fread(&footer, sizeof(footer), 1, file) == 1
+                && std::memcmp(footer.magic, FOOTER_MAGIC, sizeof(FOOTER_MAGIC)) == 0
+                && footer.index_offset + footer.chunk_count * sizeof(ChunkIndexEntry) + sizeof(footer) == size;
+    if (indexed) {
+        std::vector<ChunkIndexEntry> entries(footer.chunk_count);
+        indexed = seekTo(file, footer.index_offset)
+               && std::fread(entries.data(), sizeof(ChunkIndexEntry), entries.size(), file) == entries.size();
+        for (const ChunkIndexEntry& entry : entries) {
+            chunks.push_back({entry.first_frame, static_cast<uint32_t>(entry.frame_count), entry.offset});
+        }
+    }
+    if (!indexed) {
+        // the writer did not finish: recover every complete chunk
+        chunks.clear();
+        if (!scanChunks(size)) {
+            close();
+            return false;
+        }
+    }
+
+    for (const Chunk& chunk : chunks) {
+        frame_count = std::max<size_t>(frame_count, chunk.first_frame + chunk.frame_count);
+    }
+    return true;
+}
+
+bool TrajectoryReader::scanChunks(uint64_t data_end) {
+    uint64_t offset = sizeof(TrajectoryHeader);
+    ChunkHeader header;
+    while (offset + sizeof(header) <= data_end && seekTo(file, offset) && std::fread(&header, sizeof(header), 1, file) == 1) {
+        if (header.magic != CHUNK_MAGIC || offset + sizeof(header) + header.byte_size > data_end) {
+            break;
+        }
+        chunks.push_back({header.first_frame, header.frame_count, offset});
+        offset += sizeof(header) + header.byte_size;
+    }
+    return true;
+}
+
+bool TrajectoryReader::loadChunk(size_t chunk) {
+    ChunkHeader header;
+    if (!seekTo(file, chunks[chunk].offset) || std::fread(&header, sizeof(header), 1, file) != 1 || header.magic != CHUNK_MAGIC) {
+        return false;
+    }
+    chunk_data.resize(header.byte_size);
+    if (std::fread(chunk_data.data(), 1, chunk_data.size(), file) != chunk_data.size()) {
+        return false;
+    }
+    loaded_chunk = chunk;
+    cursor = 0;
+    next_frame = chunks[chunk].first_frame;
+    tracks[0].clear();
+    tracks[1].clear();
+    return true;
+}
+
+bool TrajectoryReader::readFrame(size_t frame, TrajectoryFrame& out) {
+    if (!file || frame >= frame_count) {
+        return false;
+    }
+    // chunks are stored in frame order
+    auto it = std::upper_bound(chunks.begin(), chunks.end(), frame, [](size_t value, const Chunk& chunk) {
+        return value < chunk.first_frame;
+    });
+    if (it == chunks.begin()) {
+        return false;
+    }
+    const size_t chunk = static_cast<size_t>(it - chunks.begin()) - 1;
+    if (frame >= chunks[chunk].first_frame + chunks[chunk].frame_count) {
+        return false;
+    }
+
+    if (chunk != loaded_chunk || frame < next_frame) {
+        if (!loadChunk(chunk)) {
+            loaded_chunk = SIZE_MAX;
+            return false;
+        }
+    }
+    while (next_frame <= frame) {
+        if (!decodeNext(out)) {
+            loaded_chunk = SIZE_MAX;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool TrajectoryReader::decodeNext(TrajectoryFrame& out) {
+    FrameHeader header;
+    if (cursor + sizeof(header) > chunk_data.size()) {
+        return false;
+    }
+    std::memcpy(&header, chunk_data.data() + cursor, sizeof(header));
+    cursor += sizeof(header);
+    if (cursor + header.payload_size > chunk_data.size()) {
+        return false;
+    }
+
+    const uint8_t* in = chunk_data.data() + cursor;
+    const uint8_t* end = in + header.payload_size;
+    const size_t count = header.particle_count;
+    // every particle takes at least three bytes
+    if (count > header.payload_size / 3) {
+        return false;
+    }
+
+    const TrajectoryTrack& last = tracks[0];
+    TrajectoryTrack& next = tracks[1];
+    next.resize(count);
+    out.x.resize(count);
+    out.y.resize(count);
+    out.handles.resize(count);
+
+    size_t match = 0;
+    uint64_t expected_slot = 0;
+    int64_t tag, value_x, value_y, generation;
+    for (size_t k = 0; k < count; ++k) {
+        if (!getVarint(in, end, tag) || tag < 0) {
+            return false;
+        }
+        const uint64_t slot = expected_slot + (static_cast<uint64_t>(tag) >> 1);
+        if (slot >= ParticleHandle::INVALID_SLOT) {
+            return false;
+        }
+        expected_slot = slot + 1;
+        while (match < last.handles.size() && last.handles[match].slot < slot) {
+            ++match;
+        }
+
+        ParticleHandle handle;
+        if (tag & 1) {
+            if (!getVarint(in, end, generation) || generation < 0 || generation > UINT32_MAX
+                || !getVarint(in, end, value_x) || !getVarint(in, end, value_y)) {
+                return false;
+            }
+            handle = {static_cast<uint32_t>(slot), static_cast<uint32_t>(generation)};
+            next.depth[k] = 1;
+        }
+        else {
+            // the particle has to be in the previous frame
+            if (match == last.handles.size() || last.handles[match].slot != slot
+                || !getVarint(in, end, value_x) || !getVarint(in, end, value_y)) {
+                return false;
+            }
+            handle = last.handles[match];
+            value_x += predict(last.x[0], last.x[1], last.depth[match], match);
+            value_y += predict(last.y[0], last.y[1], last.depth[match], match);
+            next.x[1][k] = last.x[0][match];
+            next.y[1][k] = last.y[0][match];
+            next.depth[k] = 2;
+        }
+        next.handles[k] = handle;
+        next.x[0][k] = static_cast<int32_t>(value_x);
+        next.y[0][k] = static_cast<int32_t>(value_y);
+        out.x[k] = next.x[0][k] * precision;
+        out.y[k] = next.y[0][k] * precision;
+        out.handles[k] = handle;
+    }
+    std::swap(tracks[0], tracks[1]);
+
+    out.step = header.step;
+    out.sim_time = header.sim_time;
+    cursor += header.payload_size;
+    ++next_frame;
+    return true;
+}
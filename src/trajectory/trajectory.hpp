@@ -0,0 +1,159 @@
+#ifndef TRAJECTORY_HPP
+#define TRAJECTORY_HPP
+
+#include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstdio>
+#include <cstdint>
+
+#include "../particleStore/particleStore.hpp"
+
+// Trajectory file layout (version 2, little-endian):
+//   TrajectoryHeader
+//   chunks: ChunkHeader, then frame_count frames of
+//           FrameHeader + payload (zigzag varints per particle)
+//   index:  ChunkIndexEntry per chunk
+//   TrajectoryFooter
+// The solver moves particles around its arrays (removals, re-sorts, sleep), so a
+// frame lists its particles by handle, in ascending slot order. Each particle starts
+// with the gap to the previous slot, shifted left by one, with the low bit set when
+// the particle was not in the previous frame of the chunk; such a particle then
+// stores its handle's generation and its position as it is. The others store the
+// residual of x and y from a prediction: the previous frame's position after one
+// frame, then a constant-velocity prediction (2 * q1 - q2), which for Verlet motion
+// is usually a single byte. Positions are quantised to multiples of precision.
+// Every chunk is self-contained, so the reader seeks through the index and decodes
+// at most one chunk. If the writer never finished (no footer), the reader rebuilds
+// the index by walking the chunk headers.
+// Version 1 stored frames in array order, which does not follow particles once the
+// solver compacts, re-sorts or partitions its arrays; readers refuse it.
+
+const uint32_t TRAJECTORY_VERSION = 2;
+
+struct TrajectoryOptions {
+    float precision = 0.01f;      // world units per quantisation step
+    int interval = 1;             // record every interval-th step
+    int chunk_frames = 64;        // frames per self-contained chunk
+    int queue_depth = 4;          // frames buffered before update() has to wait for the writer
+};
+
+// Frames read back are in ascending slot order, so following a handle across
+// frames follows one particle.
+struct TrajectoryFrame {
+    uint64_t step = 0;
+    double sim_time = 0.0;
+    std::vector<float> x;
+    std::vector<float> y;
+    std::vector<ParticleHandle> handles;
+};
+
+// Quantised positions of one frame's particles in slot order, matched against the
+// next frame by handle.
+struct TrajectoryTrack {
+    std::vector<ParticleHandle> handles;
+    std::vector<int32_t> x[2]; // [frames back]
+    std::vector<int32_t> y[2];
+    std::vector<uint8_t> depth; // frames of the particle in the chunk so far, at most 2
+
+    void resize(size_t count);
+    void clear();
+};
+
+struct TrajectoryStats {
+    uint64_t frames = 0;
+    uint64_t particles = 0;       // summed over frames
+    uint64_t bytes = 0;           // payload bytes, excluding headers and index
+    uint64_t stalls = 0;          // submits that waited for a free buffer
+};
+
+// Encodes and writes frames on a background thread. submit() only copies the
+// positions into a recycled buffer; quantisation, encoding and file I/O all happen
+// on the writer thread.
+class TrajectoryWriter {
+    public:
+        TrajectoryWriter(const std::string& path, const TrajectoryOptions& options_ = TrajectoryOptions());
+        ~TrajectoryWriter();
+
+        bool isOpen() const;
+        int getInterval() const;
+
+        void submit(uint64_t step, double sim_time, const ParticleStore& objects);
+        // waits for queued frames, writes the open chunk, index and footer, and closes the file
+        void close();
+
+        TrajectoryStats getStats();
+
+    private:
+        TrajectoryOptions options;
+        FILE* file;
+
+        std::thread worker;
+        std::mutex mutex;
+        std::condition_variable frame_ready;
+        std::condition_variable buffer_free;
+        std::vector<TrajectoryFrame*> pending;
+        std::vector<TrajectoryFrame*> free_frames;
+        std::vector<TrajectoryFrame> frames;
+        bool closing;
+        TrajectoryStats stats;
+
+        // writer thread state
+        TrajectoryTrack tracks[2]; // the previous frame, and the one being encoded
+        std::vector<uint32_t> slot_order;
+        std::vector<uint8_t> chunk;
+        uint64_t chunk_first_frame;
+        uint32_t chunk_frame_count;
+        uint64_t frame_index;
+        uint64_t file_offset;
+        std::vector<uint64_t> index;       // packed ChunkIndexEntry fields
+
+        void workerLoop();
+        void encodeFrame(const TrajectoryFrame& frame);
+        void flushChunk();
+};
+
+class TrajectoryReader {
+    public:
+        TrajectoryReader();
+        ~TrajectoryReader();
+
+        bool open(const std::string& path);
+        void close();
+
+        size_t getFrameCount() const;
+        float getPrecision() const;
+        int getInterval() const;
+
+        // random access; reading consecutive frames decodes incrementally
+        bool readFrame(size_t frame, TrajectoryFrame& out);
+
+    private:
+        struct Chunk {
+            uint64_t first_frame;
+            uint32_t frame_count;
+            uint64_t offset;
+        };
+
+        FILE* file;
+        float precision;
+        int interval;
+        size_t frame_count;
+        std::vector<Chunk> chunks;
+
+        // decoder state for the chunk in memory
+        size_t loaded_chunk;
+        std::vector<uint8_t> chunk_data;
+        size_t cursor;
+        size_t next_frame;
+        TrajectoryTrack tracks[2];
+
+        bool scanChunks(uint64_t data_end);
+        bool loadChunk(size_t chunk);
+        bool decodeNext(TrajectoryFrame& out);
+};
+
+#endif
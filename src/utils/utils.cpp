@@ -46,15 +46,6 @@ float generateRandom(const float max, const float min){
     return min + static_cast<float>(rand()) / (static_cast<float>(RAND_MAX/(max - min)));
 }
 
-void spawnParticles(Solver& solver, float current_time, float last_spawn_time){
-    if (solver.getObjects().size() < SolverConstants::MAX_OBJECTS && current_time - last_spawn_time >= SolverConstants::SPAWN_DELAY){
-        last_spawn_time = current_time;
-
-        auto& object = solver.addObject(SolverConstants::SPAWN_POSITION);
-        solver.setObjectVelocity(object, glm::vec2({1.0f, -1.0f}) * SolverConstants::SPAWN_VELOCITY);
-    }
-}
-
 void gravityMousePull(Solver& solver, GLFWwindow* window){
     int state = glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT);
         if (state == GLFW_PRESS)
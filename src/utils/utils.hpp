@@ -12,7 +12,6 @@
 GLFWwindow* StartGLFW();
 void setUpGL(const std::tuple<float, float, float, float> background_rgb);
 float generateRandom(const float max, const float min);
-void spawnParticles(Solver& solver, float current_time, float last_spawn_time);
 void gravityMousePull(Solver& solver, GLFWwindow* window);
 
 #endif
\ No newline at end of file